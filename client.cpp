@@ -8,6 +8,8 @@
 #include <sys/mman.h>
 #include <pthread.h>
 #include <cstdlib>
+#include <cstdio>
+#include <ctime>
 
 using namespace std;
 
@@ -20,16 +22,61 @@ static const char* SHM_NAME = "/guess_game_shm_demo";
 
 static void clearScreen() { system("clear"); }
 
+// ---- Tracing (GUESS_TRACE=1): same event format as the server's ----
+static bool trace_on = false;
+static FILE* trace_fp = nullptr;
+
+static long long traceNowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void traceOpen(int player_id) {
+    const char* env = getenv("GUESS_TRACE");
+    trace_on = env && strcmp(env, "1") == 0;
+    if (!trace_on) return;
+
+    string path = "/tmp/guess_game_trace." + to_string(getpid()) + ".jsonl";
+    trace_fp = fopen(path.c_str(), "w");    // a reused pid starts clean
+    if (!trace_fp) {
+        trace_on = false;
+        return;
+    }
+    fprintf(trace_fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+            "\"args\":{\"name\":\"client %d (player %d)\"}}\n", getpid(), getpid(), player_id);
+}
+
+// One span; flow 's' starts the guess's arrow, 0 leaves it out
+static void traceSpan(const char* name, unsigned long long id, long long t0, char flow) {
+    if (!trace_on) return;
+    long long t1 = traceNowNs();
+    fprintf(trace_fp, "{\"name\":\"%s\",\"cat\":\"guess\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+            "\"pid\":%d,\"tid\":%d,\"args\":{\"guess_id\":%llu}}\n",
+            name, t0 / 1000.0, (t1 - t0) / 1000.0, getpid(), getpid(), id);
+    if (flow) {
+        fprintf(trace_fp, "{\"name\":\"guess\",\"cat\":\"guess\",\"ph\":\"%c\",\"id\":%llu,"
+                "\"ts\":%.3f,\"pid\":%d,\"tid\":%d}\n", flow, id, t0 / 1000.0, getpid(), getpid());
+    }
+    fflush(trace_fp);
+}
+
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        cout << "Usage: ./client <player_id>\n";
+    if (argc != 2 && argc != 3) {
+        cout << "Usage: ./client <player_id> [room]\n";
         return 1;
     }
 
     int player_id = atoi(argv[1]);
     string my_fifo = "/tmp/guess_game_client_" + to_string(player_id);
+    if (argc == 3) {
+        // Rooms of "./server multi" have one FIFO per room and seat
+        my_fifo = "/tmp/guess_game_client_" + string(argv[2]) + "_" + to_string(player_id);
+    }
     
     cout << "👤 Player " << player_id << endl;
+    traceOpen(player_id);
+    unsigned long long guess_seq = 0;
     
     // Wait for server
     cout << "Connecting to server...";
@@ -104,23 +151,30 @@ int main(int argc, char* argv[]) {
                 // ===== SEND GUESS =====
                 cout << "📤 Sending guess: " << guess << endl;
                 
-                string guess_msg = "GUESS " + to_string(player_id) + " " + to_string(guess);
+                // The id lets the server tag its spans for this guess
+                unsigned long long guess_id = ((unsigned long long)getpid() << 24) | ++guess_seq;
+                string guess_msg = "GUESS " + to_string(player_id) + " " + to_string(guess) +
+                                   " " + to_string(guess_id);
+                long long t_send = traceNowNs();
                 int fd_send = open(my_fifo.c_str(), O_WRONLY);
                 if (fd_send > 0) {
                     write(fd_send, guess_msg.c_str(), guess_msg.length() + 1);
                     close(fd_send);
                 }
+                traceSpan("client_send", guess_id, t_send, 's');
                 
                 // ===== GET RESULT =====
                 cout << "⏳ Waiting for result..." << endl;
                 
                 char result[256];
                 memset(result, 0, sizeof(result));
+                long long t_wait = traceNowNs();
                 int fd_result = open(my_fifo.c_str(), O_RDONLY);
                 if (fd_result > 0) {
                     read(fd_result, result, sizeof(result));
                     close(fd_result);
                 }
+                traceSpan("client_wait_result", guess_id, t_wait, 0);
                 
                 cout << "📡 Result: " << result << endl;
                 
@@ -154,6 +208,5 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    munmap(st, sizeof(SharedState));
     return 0;
 }
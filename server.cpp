@@ -1,644 +1,3232 @@
-#include <iostream>
-#include <pthread.h>
-#include <fcntl.h>
-#include <sys/mman.h>
-#include <sys/stat.h>
-#include <sys/file.h>
-#include <unistd.h>
-#include <signal.h>
-
-#include <cstdio>
-#include <cstdlib>
-#include <cstring>
-#include <ctime>
-
-#include <string>
-#include <queue>
-using namespace std;
-
-// ---------------------------
-// Shared memory layout
-// ---------------------------
-struct SharedState {
-    pthread_mutex_t shared_mutex;
-    int shared_int[4];
-};
-
-// ---------------------------
-// Logger queue (producer)
-// ---------------------------
-static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t  log_cv    = PTHREAD_COND_INITIALIZER;
-static queue<string> log_queue;
-static bool logger_running = true;
-
-static const char* SHM_NAME = "/guess_game_shm_demo";
-static const int MAX_PLAYERS = 4;
-
-/* =========================================================
-   =============== Member 4: Persistence ===================
-   ========================================================= */
-
-static int player_scores[MAX_PLAYERS] = {0};
-static const char* SCORE_FILE = "scores.txt";
-
-static string nowString();
-static void logPush(const string& msg);
-static void saveScores();
-static volatile sig_atomic_t g_stop = 0;
-
-// Load scores
-static void loadScores() {
-    FILE* fp = fopen(SCORE_FILE, "r");
-    if (!fp) {
-        logPush("[SCORE] No existing scores.txt, starting fresh.");
-        return;
-    }
-
-    for (int i = 0; i < MAX_PLAYERS; i++) {
-        fscanf(fp, "%d", &player_scores[i]);
-    }
-
-    fclose(fp);
-    logPush("[SCORE] Scores loaded from file.");
-}
-
-/* =========================================================
-   =============== Member 3: Game Logic ====================
-   ========================================================= */
-
-static int secret_number = -1;
-static int winner_id = -1;
-
-// Generate a new secret number
-static void generateSecretNumber() {
-    srand(time(nullptr) ^ getpid());
-    secret_number = (rand() % 100) + 1;  // 1 to 100
-    logPush("[GAME] New secret number generated: " + to_string(secret_number));
-}
-
-// Process a guess from a player
-static string processGuess(int player_id, int guess) {
-    if (secret_number == -1) {
-        generateSecretNumber();
-    }
-
-    if (guess == secret_number) {
-        winner_id = player_id;
-        player_scores[player_id]++;  // Increase score
-        
-        // Log win
-        logPush("[GAME] Player " + to_string(player_id) + 
-                " guessed " + to_string(guess) + " and WON!");
-        
-        return "WIN Correct! You guessed the number.";
-    }
-    else if (guess < secret_number) {
-        return "HIGHER! Guess higher!";
-    }
-    else {
-        return "LOWER! Guess lower!";
-    }
-}
-
-// Start a new game
-static void startNewGame() {
-    generateSecretNumber();
-    winner_id = -1;
-    logPush("[GAME] New game started.");
-}
-
-/* =========================================================
-   =============== Member 3: Client Handler ================
-   ========================================================= */
-static void logAppendDirect(const string& msg) {
-    int fd = open("game.log", O_WRONLY | O_CREAT | O_APPEND, 0666);
-    if (fd < 0) return;
-
-    flock(fd, LOCK_EX); // lock file (prevents mixed lines)
-
-    string line = nowString() + " " + msg + "\n";
-    write(fd, line.c_str(), line.size());
-
-    flock(fd, LOCK_UN);
-    close(fd);
-}
-
-static bool connected = false;
-static void handleClient(int player_id) {
-<<<<<<< HEAD
-    std::cout << "=== DEBUG handleClient: Player " << player_id << " starting ===" << std::endl;
-
-    char fifo_name[100];
-    snprintf(fifo_name, sizeof(fifo_name), "/tmp/guess_game_client_%d", player_id);
-    
-    // Create FIFO for this client
-    mkfifo(fifo_name, 0666);
-    
-    logPush("[CLIENT] Player " + to_string(player_id) + " connected via " + string(fifo_name));
-    
-    int fd = open(fifo_name, O_RDONLY | O_NONBLOCK);
-    
-    while (true) {
-        char buffer[256];
-        memset(buffer, 0, sizeof(buffer));
-        
-        // ===== FUNCTION TO GET CURRENT PLAYER (FRESH) =====
-        auto getCurrentPlayer = []() -> int {
-            int shm_fd = shm_open(SHM_NAME, O_RDWR, 0666);
-            if (shm_fd < 0) return -1;
-            
-            SharedState* st = (SharedState*)mmap(nullptr, sizeof(SharedState), 
-                                               PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-            close(shm_fd);
-            if (!st) return -1;
-            
-            pthread_mutex_lock(&st->shared_mutex);
-            int current = st->shared_int[0];
-            pthread_mutex_unlock(&st->shared_mutex);
-            
-            munmap(st, sizeof(SharedState));
-            return current;
-        };
-        
-        // Get FRESH current player
-        int current_player = getCurrentPlayer();
-        if (current_player == -1) break;
-        
-        // Check if game ended
-        // (You might need to check game_over here too)
-        
-        cout << "DEBUG Player " << player_id << ": My turn? current=" << current_player << ", me=" << player_id << endl;
-        
-        // Read client message (non-blocking)
-        if (read(fd, buffer, sizeof(buffer)) > 0) {
-            cout << "DEBUG: Player " << player_id << " sent: " << buffer << endl;
-            
-            // ===== ASK_TURN HANDLER (WITH FRESH CHECK) =====
-            if (strstr(buffer, "ASK_TURN") != nullptr) {
-                int asking_player;
-                sscanf(buffer, "ASK_TURN %d", &asking_player);
-                
-                // Get FRESH current player again (right now!)
-                int current_now = getCurrentPlayer();
-                
-                // Send turn status
-                int fd_resp = open(fifo_name, O_WRONLY);
-                if (fd_resp > 0) {
-                    if (current_now == asking_player) {
-                        write(fd_resp, "YES_YOUR_TURN", 14);
-                        cout << "✅ SENT YES to Player " << asking_player << " (current=" << current_now << ")" << endl;
-                    } else {
-                        string msg = "NO Player " + to_string(current_now) + "'s turn";
-                        write(fd_resp, msg.c_str(), msg.length() + 1);
-                        cout << "❌ SENT NO to Player " << asking_player << " (current=" << current_now << ")" << endl;
-                    }
-                    close(fd_resp);
-                }
-                continue;  // Don't process as guess
-            }
-            
-            // ===== GUESS HANDLER =====
-            // Only process if it's REALLY this player's turn
-            if (current_player != player_id) {
-                cout << "🚫 REJECTING guess from Player " << player_id << " - It's Player " << current_player << "'s turn!" << endl;
-                
-                // Send rejection message
-                int fd_resp = open(fifo_name, O_WRONLY);
-                if (fd_resp > 0) {
-                    string msg = "REJECT Not your turn! Player " + to_string(current_player) + "'s turn";
-                    write(fd_resp, msg.c_str(), msg.length() + 1);
-                    close(fd_resp);
-                }
-                continue;
-            }
-            
-            // Process guess (only if it's really their turn)
-=======
-    char fifo_name[100];
-    snprintf(fifo_name, sizeof(fifo_name), "/tmp/guess_game_client_%d", player_id);
-
-    // Create FIFO for this client (server side)
-    unlink(fifo_name);
-    mkfifo(fifo_name, 0666);
-
-    // Open FIFO for reading guesses (non-blocking)
-    int fd = open(fifo_name, O_RDWR | O_NONBLOCK);
-
-    if (fd < 0) {
-        logPush("[CLIENT] Failed to open FIFO for player " + to_string(player_id));
-        return;
-    }
-
-    // ---- Open shared memory ONCE ----
-    int shm_fd = shm_open(SHM_NAME, O_RDWR, 0666);
-    if (shm_fd < 0) {
-        close(fd);
-        return;
-    }
-
-    SharedState* st = (SharedState*)mmap(nullptr, sizeof(SharedState),
-                                         PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-    close(shm_fd);
-
-    if (st == MAP_FAILED) {
-        close(fd);
-        return;
-    }
-
-    logPush("[CLIENT] Player " + to_string(player_id) + " connected via " + string(fifo_name));
-
-    while (true) {
-        // Check game status + turn
-        pthread_mutex_lock(&st->shared_mutex);
-        int current_player = st->shared_int[0];
-        int game_over      = st->shared_int[3];
-        pthread_mutex_unlock(&st->shared_mutex);
-
-        if (game_over == 1) break;
-
-        if (current_player != player_id) {
-            usleep(50 * 1000);
-            continue;
-        }
-
-        // Read guess
-        char buffer[256];
-        memset(buffer, 0, sizeof(buffer));
-        ssize_t n = read(fd, buffer, sizeof(buffer));
-
-        if (n > 0) {
->>>>>>> main
-            int guess;
-            if (sscanf(buffer, "GUESS %*d %d", &guess) == 1) {
-                if (!connected) {
-                    pthread_mutex_lock(&st->shared_mutex);
-                    st->shared_int[1] |= (1 << player_id);
-                    pthread_mutex_unlock(&st->shared_mutex);
-                    printf("Player %d CONNECTED\n", player_id);
-                    fflush(stdout);
-                    connected = true;
-
-                    logPush("[CLIENT] Player " + to_string(player_id) + " is connected");
-                    
-                }
-<<<<<<< HEAD
-                
-                logPush("[CLIENT] Player " + to_string(player_id) + " guessed " + to_string(guess) + " -> " + response);
-                
-                // If win, end game
-                if (response.find("WIN") != string::npos) {
-                    // Set game over flag
-                    int shm_fd2 = shm_open(SHM_NAME, O_RDWR, 0666);
-                    if (shm_fd2 >= 0) {
-                        SharedState* st2 = (SharedState*)mmap(nullptr, sizeof(SharedState), 
-                                                            PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd2, 0);
-                        close(shm_fd2);
-                        
-                        if (st2) {
-                            pthread_mutex_lock(&st2->shared_mutex);
-                            st2->shared_int[3] = 1;  // Game over
-                            pthread_mutex_unlock(&st2->shared_mutex);
-                            munmap(st2, sizeof(SharedState));
-                        }
-                    }
-=======
-
-                // Log guess (direct append works even in forked child)
-                logAppendDirect("[GAME] Player " + to_string(player_id) +
-                                " guess number " + to_string(guess));
-
-                string response = processGuess(player_id, guess);
-
-                // Send response back (same FIFO, your current design)
-                if (write(fd, response.c_str(), response.size() + 1) < 0) {
-                    logPush("[CLIENT] Failed to write response to player " + to_string(player_id));
-                }
-
-                pthread_mutex_lock(&st->shared_mutex);
-                st->shared_int[2] = 1;   // current player finished move
-                pthread_mutex_unlock(&st->shared_mutex);
-
-
-                // If win -> end game
-                if (response.find("WIN") != string::npos) {
-                    pthread_mutex_lock(&st->shared_mutex);
-                    st->shared_int[3] = 1;
-                    pthread_mutex_unlock(&st->shared_mutex);
->>>>>>> main
-                    break;
-                }
-            }
-        } else {
-            // n == 0: no writer yet OR client closed; treat as "no input" for now
-            // n < 0 and errno==EAGAIN: no data (non-blocking), normal
-            usleep(100 * 1000);
-        }
-    }
-
-    pthread_mutex_lock(&st->shared_mutex);
-    st->shared_int[1] &= ~(1 << player_id);
-    pthread_mutex_unlock(&st->shared_mutex);
-
-    munmap(st, sizeof(SharedState));
-    close(fd);
-    unlink(fifo_name);
-
-    logPush("[CLIENT] Player " + to_string(player_id) + " disconnected");
-}
-
-
-// ====================== saveScores() ======================
-static void saveScores() {
-    FILE* fp = fopen(SCORE_FILE, "w");
-    if (!fp) return;
-
-    for (int i = 0; i < MAX_PLAYERS; i++) {
-        fprintf(fp, "%d\n", player_scores[i]);
-    }
-
-    fclose(fp);
-    logPush("[SCORE] Scores saved to file.");
-}
-
-
-// SIGINT handler :only notify the program that it should terminate, no direct save data
-// SIGINT handler: only notify program to stop
-static void sigintHandler(int) {
-    g_stop = 1;
-}
-
-
-// Reset game state but keep scores
-static void resetGameState(SharedState* st) {
-    pthread_mutex_lock(&st->shared_mutex);
-    st->shared_int[0] = 0;
-    st->shared_int[2] = -1;
-    st->shared_int[3] = 0;
-    pthread_mutex_unlock(&st->shared_mutex);
-
-    logPush("[GAME] Game state reset. Scores preserved.");
-}
-
-/* =========================================================
-   =================== Existing Code =======================
-   ========================================================= */
-
-// Helper: current time string
-static string nowString() {
-    char buf[64];
-    time_t t = time(nullptr);
-    tm tm{};
-    localtime_r(&t, &tm);
-    snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d",
-                  tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
-                  tm.tm_hour, tm.tm_min, tm.tm_sec);
-    return string(buf);
-}
-
-// Push a log message (thread-safe)
-static void logPush(const string& msg) {
-    pthread_mutex_lock(&log_mutex);
-    log_queue.push(nowString() + " " + msg);
-    pthread_cond_signal(&log_cv);
-    pthread_mutex_unlock(&log_mutex);
-}
-
-// ---------------------------
-// Round Robin Scheduler Thread
-// ---------------------------
-struct SchedulerArgs {
-    SharedState* st;
-    int quantum_ms;
-};
-
-static int findNextConnected(int current, int connected_mask) {
-    if (connected_mask == 0) return -1; // nobody connected
-
-    for (int step = 1; step <= MAX_PLAYERS; step++) {
-        int next = (current + step) % MAX_PLAYERS;
-        if (connected_mask & (1 << next)) return next;
-    }
-<<<<<<< HEAD
-    return (current + 1) % MAX_PLAYERS; }
-=======
-
-    // If we get here, it means ONLY current is connected (or mask weird)
-    if (connected_mask & (1 << current)) return current;
-    return -1;
-}
->>>>>>> main
-
-static void* roundRobinThread(void* arg) {
-    SchedulerArgs* a = (SchedulerArgs*)arg;
-    SharedState* st = a->st;
-
-    while (true) {
-        usleep(50 * 1000); 
-
-        pthread_mutex_lock(&st->shared_mutex);
-
-        int game_status    = st->shared_int[3];
-        int current_player = st->shared_int[0];
-        int connected_mask = st->shared_int[1];
-        int turn_done      = st->shared_int[2];
-
-        if (game_status != 0) {
-            pthread_mutex_unlock(&st->shared_mutex);
-            break;
-        }
-
-        if (connected_mask == 0) {
-            pthread_mutex_unlock(&st->shared_mutex);
-            continue;
-        }
-
-        // current not connected -> skip immediately
-        if ((connected_mask & (1 << current_player)) == 0) {
-            int fixed = findNextConnected(current_player, connected_mask);
-            if (fixed != -1) {
-                st->shared_int[0] = fixed;
-                st->shared_int[2] = 0;  
-            }
-            pthread_mutex_unlock(&st->shared_mutex);
-            continue;
-        }
-
-
-        // ONLY rotate when current player finished a move
-        if (turn_done == 1) {
-            int next = findNextConnected(current_player, connected_mask);
-            if (next != -1) st->shared_int[0] = next;
-            st->shared_int[2] = 0; // reset turn_done
-        }
-
-        pthread_mutex_unlock(&st->shared_mutex);
-    }
-    return nullptr;
-}
-
-
-// ---------------------------
-// Logger Thread
-// ---------------------------
-static void* loggerThread(void*) {
-    FILE* fp = fopen("game.log", "a");
-    if (!fp) return nullptr;
-
-    logPush("[LOG] Logger started.");
-
-    while (true) {
-        pthread_mutex_lock(&log_mutex);
-        while (log_queue.empty() && logger_running) {
-            pthread_cond_wait(&log_cv, &log_mutex);
-        }
-
-        if (!logger_running && log_queue.empty()) {
-            pthread_mutex_unlock(&log_mutex);
-            break;
-        }
-
-        string msg = log_queue.front();
-        log_queue.pop();
-        pthread_mutex_unlock(&log_mutex);
-
-        fprintf(fp, "%s\n", msg.c_str());
-        fflush(fp);
-    }
-
-    fprintf(fp, "%s\n", (nowString() + " [LOG] Logger stopped.").c_str());
-    fclose(fp);
-    return nullptr;
-}
-
-// ---------------------------
-// Process-shared mutex init
-// ---------------------------
-static void initProcessSharedMutex(pthread_mutex_t* mtx) {
-    pthread_mutexattr_t attr;
-    pthread_mutexattr_init(&attr);
-    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
-    pthread_mutex_init(mtx, &attr);
-    pthread_mutexattr_destroy(&attr);
-}
-
-// ---------------------------
-// Shared memory setup
-// ---------------------------
-static SharedState* createOrOpenSharedMemory(bool create_new) {
-    int fd;
-    if (create_new) {
-        shm_unlink(SHM_NAME);
-        fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
-    } else {
-        fd = shm_open(SHM_NAME, O_RDWR, 0666);
-    }
-
-    if (fd < 0) return nullptr;
-
-    if (create_new) {
-        ftruncate(fd, sizeof(SharedState));
-    }
-
-    void* mem = mmap(nullptr, sizeof(SharedState),
-                     PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    close(fd);
-
-    return (SharedState*)mem;
-}
-
-int main() {
-    signal(SIGINT, sigintHandler);
-
-    SharedState* st = createOrOpenSharedMemory(true);
-    if (!st) return 1;
-
-    memset(st, 0, sizeof(SharedState));
-    initProcessSharedMutex(&st->shared_mutex);
-
-    pthread_mutex_lock(&st->shared_mutex);
-    st->shared_int[0] = 0;   // current player
-<<<<<<< HEAD
-    st->shared_int[1] = 0b1111;   // connected_mask (start empty)
-    st->shared_int[2] = -1;
-=======
-    st->shared_int[1] = 0;   // connected_mask (start empty)
-    st->shared_int[2] = 0;   // turn_done 
->>>>>>> main
-    st->shared_int[3] = 0;   // game running
-    pthread_mutex_unlock(&st->shared_mutex);
-
-    // Create server FIFO
-    int fifo_result = mkfifo("/tmp/guess_game_server", 0666);
-    if (fifo_result == -1) {
-        perror("mkfifo failed");
-    } else {
-        cout << "Server FIFO CREATED SUCCESSFULLY" << endl;
-    }
-
-    loadScores();
-
-    // ============ ADD THIS LINE ============
-    startNewGame();  // Start the guessing game!
-    // ============ END ADDED CODE ============
-
-    printf("Server listening on port 8080...\n");
-    printf("Waiting for players to connect...\n");
-
-    printf("Game started!\n");
-
-    logPush("[MAIN] Forking client processes...");
-    
-    // Fork child processes for 4 players
-    for (int i = 0; i < 4; i++) {
-        pid_t pid = fork();
-        if (pid == 0) {
-            // Child process: handle one client
-            handleClient(i);
-            exit(0);  // IMPORTANT: Exit after handling
-        }
-        else if (pid > 0) {
-            printf("Forked player %d (PID: %d)\n", i, pid);
-            logPush("[MAIN] Forked player " + to_string(i) + 
-                    " (PID: " + to_string(pid) + ")");
-        }
-    }
-        // ---- Scheduler thread ----
-    SchedulerArgs schedArgs{st, 10000};
-    pthread_t sched_tid;
-    pthread_create(&sched_tid, nullptr, roundRobinThread, &schedArgs);
-
-    // ---- Logger thread ----
-    pthread_t log_tid;
-    pthread_create(&log_tid, nullptr, loggerThread, nullptr);
-    
-    logPush("[MAIN] Server running.");
-
-    // ---- Main loop ----
-    while (!g_stop) {
-        usleep(100 * 1000);
-    }
-
-    printf("Server shutting down...\n");
-    logPush("[SIGNAL] SIGINT received. Saving scores...");
-
-    saveScores();
-
-    pthread_mutex_lock(&st->shared_mutex);
-    st->shared_int[3] = 1; // stop scheduler
-    pthread_mutex_unlock(&st->shared_mutex);
-
-    pthread_join(sched_tid, nullptr);
-
-    pthread_mutex_lock(&log_mutex);
-    logger_running = false;
-    pthread_cond_signal(&log_cv);
-    pthread_mutex_unlock(&log_mutex);
-
-    pthread_join(log_tid, nullptr);
-
-    munmap(st, sizeof(SharedState));
-    shm_unlink(SHM_NAME);
-
-    return 0;
+#include <iostream>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/timerfd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sched.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+#include <algorithm>
+#include <atomic>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// ---------------------------
+// Log levels (compile-time)
+// ---------------------------
+// Build with -DLOG_LEVEL=<n>; calls below that level compile to nothing,
+// arguments included.
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF   4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logRecord(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) logRecord(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) logRecord(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logRecord(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+// ---------------------------
+// Shared memory layout
+// ---------------------------
+// One guess of the current game, as kept for the history journal
+struct GameMove {
+    uint8_t  seat;
+    uint8_t  guess;         // clamped to 0..255, see moveGuess()
+    uint16_t reserved;
+    uint32_t t_ms;          // since the game started
+};
+
+// Guesses are only meaningful in 1..100 but any int is accepted and
+// judged; keep out-of-range ones recognisable instead of wrapping them
+static uint8_t moveGuess(int guess) {
+    return (uint8_t)(guess < 0 ? 0 : guess > 255 ? 255 : guess);
+}
+
+static const int MAX_MOVES = 256;
+
+struct GameMoves {
+    int64_t  start_ms;      // wall clock
+    int      count;
+    GameMove list[MAX_MOVES];
+};
+
+// Also the per-room state of the host-wide room table of "./server
+// multi", which outlives binaries: any change here needs a new
+// ROOM_TABLE_VERSION (older tables are then rebuilt or refused).
+struct SharedState {
+    pthread_mutex_t shared_mutex;
+    int shared_int[4];
+    int64_t last_active_ms[4];  // monoMs() of a player's last request
+    int winner;             // seat that won the current game, -1 if none yet
+    GameMoves moves;        // guesses of the current game
+
+    // Tracing: the guess that ended the last turn and when things happened
+    uint64_t trace_id;
+    int64_t  turn_done_ns;  // handler set turn_done
+    int64_t  turn_start_ns; // scheduler handed the turn on
+};
+
+// Lock a room's mutex. The mutex is robust: if a process died while
+// holding it, take it over and mark it consistent again.
+static void stateLock(SharedState* st) {
+    if (pthread_mutex_lock(&st->shared_mutex) == EOWNERDEAD) {
+        pthread_mutex_consistent(&st->shared_mutex);
+    }
+}
+
+// Helper: wall clock in milliseconds
+static int64_t wallMs() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Helper: monotonic clock in milliseconds, the same in every process
+static int64_t monoMs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// ---------------------------
+// Guess tracing
+// ---------------------------
+// Off unless GUESS_TRACE=1 is set at startup; a disabled span costs one
+// predictable branch and no clock read. Every guess carries an id (from
+// the client, or assigned on arrival) and each stage it passes through
+// records a span tagged with it. Spans go into a per-process ring that
+// writers fill without locks: a writer reserves a slot with fetch_add and
+// stamps it with its sequence number when done. traceFlush() appends the
+// finished slots as Chrome trace events to /tmp/guess_game_trace.<pid>.jsonl
+// (truncated when the process first opens it, so a reused pid starts
+// clean) and "./server trace-merge" joins every process's file into one
+// Chrome/Perfetto trace, then removes the files of processes that have
+// exited, so the next merge holds only what ran after it. Flow events
+// link the spans of one guess across processes. A slot lapped before it
+// was flushed is counted, not written.
+static const uint32_t TRACE_RING = 1 << 14;   // power of two
+static const char*    TRACE_PREFIX = "/tmp/guess_game_trace.";
+
+struct TraceEvent {
+    atomic<uint64_t> seq;       // slot index + 1 once complete, 0 while written
+    const char* name;           // string literal
+    uint64_t    id;             // guess id
+    int64_t     ts_ns;
+    int64_t     dur_ns;
+    int         tid;
+    char        flow;           // 's' first stage, 't' middle, 'f' last, 0 none
+};
+
+static bool trace_enabled = false;
+static const char* trace_process = "server";
+static TraceEvent trace_ring[TRACE_RING];
+static atomic<uint64_t> trace_head(0);
+static pthread_mutex_t trace_flush_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t trace_flushed = 0;
+static uint64_t trace_lost = 0;
+static int trace_fd = -1;
+static thread_local int trace_tid = 0;
+
+static int64_t traceNowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);     // host-wide, so processes line up
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Start of a span: 0 when tracing is off
+static inline int64_t traceBegin() {
+    return trace_enabled ? traceNowNs() : 0;
+}
+
+static void traceRecord(const char* name, uint64_t id, int64_t start_ns, int64_t end_ns, char flow) {
+    if (!trace_tid) trace_tid = (int)syscall(SYS_gettid);
+
+    uint64_t idx = trace_head.fetch_add(1, memory_order_relaxed);
+    TraceEvent& e = trace_ring[idx & (TRACE_RING - 1)];
+    e.seq.store(0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    e.name = name;
+    e.id = id;
+    e.ts_ns = start_ns;
+    e.dur_ns = end_ns - start_ns;
+    e.tid = trace_tid;
+    e.flow = flow;
+    e.seq.store(idx + 1, memory_order_release);
+}
+
+// End of a span begun with traceBegin()
+static inline void traceEnd(const char* name, uint64_t id, int64_t start_ns, char flow) {
+    if (trace_enabled && id) traceRecord(name, id, start_ns, traceNowNs(), flow);
+}
+
+// A guess id unique on the host: pid in the high bits, a counter below
+static uint64_t traceNewId() {
+    static atomic<uint32_t> counter(0);
+    return ((uint64_t)getpid() << 24) | ((counter.fetch_add(1) + 1) & 0xffffff);
+}
+
+// Timestamps are in microseconds; integer formatting keeps the flush cheap
+static void traceWriteEvent(string& out, const TraceEvent& e, int pid) {
+    char line[320];
+    long long ts = e.ts_ns, dur = e.dur_ns;
+    snprintf(line, sizeof(line),
+             "{\"name\":\"%s\",\"cat\":\"guess\",\"ph\":\"X\",\"ts\":%lld.%03lld,\"dur\":%lld.%03lld,"
+             "\"pid\":%d,\"tid\":%d,\"args\":{\"guess_id\":%llu}}\n",
+             e.name, ts / 1000, ts % 1000, dur / 1000, dur % 1000, pid, e.tid, (unsigned long long)e.id);
+    out += line;
+    if (e.flow) {
+        snprintf(line, sizeof(line),
+                 "{\"name\":\"guess\",\"cat\":\"guess\",\"ph\":\"%c\",\"id\":%llu,\"ts\":%lld.%03lld,"
+                 "\"pid\":%d,\"tid\":%d%s}\n",
+                 e.flow, (unsigned long long)e.id, ts / 1000, ts % 1000, pid, e.tid,
+                 e.flow == 'f' ? ",\"bp\":\"e\"" : "");
+        out += line;
+    }
+}
+
+// Append every completed span to this process's trace file
+static void traceFlush() {
+    if (!trace_enabled || trace_head.load(memory_order_acquire) == trace_flushed) return;
+
+    pthread_mutex_lock(&trace_flush_mutex);
+    int pid = getpid();
+    string out;
+    if (trace_fd < 0) {
+        char path[64];
+        snprintf(path, sizeof(path), "%s%d.jsonl", TRACE_PREFIX, pid);
+        trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0666);
+        char meta[160];
+        snprintf(meta, sizeof(meta),
+                 "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%s %d\"}}\n",
+                 pid, trace_process, pid);
+        out += meta;
+    }
+
+    uint64_t head = trace_head.load(memory_order_acquire);
+    if (head - trace_flushed > TRACE_RING) {
+        trace_lost += head - TRACE_RING - trace_flushed;
+        trace_flushed = head - TRACE_RING;
+    }
+    for (; trace_flushed < head; trace_flushed++) {
+        const TraceEvent& slot = trace_ring[trace_flushed & (TRACE_RING - 1)];
+        uint64_t seq = slot.seq.load(memory_order_acquire);
+        if (seq < trace_flushed + 1) break;          // still being written
+        if (seq > trace_flushed + 1) {               // lapped
+            trace_lost++;
+            continue;
+        }
+        TraceEvent copy;
+        copy.name = slot.name;
+        copy.id = slot.id;
+        copy.ts_ns = slot.ts_ns;
+        copy.dur_ns = slot.dur_ns;
+        copy.tid = slot.tid;
+        copy.flow = slot.flow;
+        atomic_thread_fence(memory_order_acquire);
+        if (slot.seq.load(memory_order_relaxed) != seq) {
+            trace_lost++;
+            continue;
+        }
+        traceWriteEvent(out, copy, pid);
+    }
+
+    if (trace_fd >= 0 && !out.empty()) write(trace_fd, out.data(), out.size());
+    pthread_mutex_unlock(&trace_flush_mutex);
+}
+
+// A forked child starts with an empty ring and its own file
+static void traceAfterForkChild() {
+    trace_head.store(0);
+    trace_flushed = 0;
+    trace_lost = 0;
+    trace_fd = -1;
+    trace_tid = 0;
+    pthread_mutex_init(&trace_flush_mutex, nullptr);
+}
+
+static void traceInit(const char* process) {
+    const char* env = getenv("GUESS_TRACE");
+    trace_enabled = env && strcmp(env, "1") == 0;
+    trace_process = process;
+    if (trace_enabled) pthread_atfork(nullptr, nullptr, traceAfterForkChild);
+}
+
+// ---------------------------
+// Logger ring (producer)
+// ---------------------------
+// A record keeps the format literal and the raw arguments; "{}" in the
+// format is replaced by the logger thread, not by the caller.
+static const int LOG_RING_SIZE = 1024;
+static const int LOG_ARG_BYTES = 192;
+
+struct LogRecord {
+    const char*   fmt;     // string literal, never copied
+    time_t        ts;
+    unsigned char level;
+    unsigned char nargs;
+    unsigned short used;
+    char args[LOG_ARG_BYTES];
+};
+
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  log_cv    = PTHREAD_COND_INITIALIZER;
+static LogRecord log_ring[LOG_RING_SIZE];
+static unsigned log_head = 0;      // next slot to write
+static unsigned log_tail = 0;      // next slot to read
+static unsigned log_dropped = 0;   // records lost because the ring was full
+static bool logger_running = true;
+static pthread_t logger_tid;
+static const char* log_path = "game.log";
+
+static const char* SHM_NAME = "/guess_game_shm_demo";
+static const int MAX_PLAYERS = 4;
+
+/* =========================================================
+   =============== Member 4: Persistence ===================
+   ========================================================= */
+
+static int player_scores[MAX_PLAYERS] = {0};
+static const char* SCORE_FILE = "scores.txt";
+
+static string nowString();
+static void formatTime(time_t t, char* buf, size_t len);
+template<typename... Args>
+static void logRecord(int level, const char* fmt, const Args&... args);
+static void saveScores();
+static volatile sig_atomic_t g_stop = 0;
+
+// Load scores
+static void loadScores() {
+    FILE* fp = fopen(SCORE_FILE, "r");
+    if (!fp) {
+        LOG_INFO("[SCORE] No existing scores.txt, starting fresh.");
+        return;
+    }
+
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        fscanf(fp, "%d", &player_scores[i]);
+    }
+
+    fclose(fp);
+    LOG_INFO("[SCORE] Scores loaded from file.");
+}
+
+/* =========================================================
+   =============== Member 3: Game Logic ====================
+   ========================================================= */
+
+static int secret_number = -1;
+static int winner_id = -1;
+
+// Generate a new secret number
+static void generateSecretNumber() {
+    srand(time(nullptr) ^ getpid());
+    secret_number = (rand() % 100) + 1;  // 1 to 100
+    LOG_INFO("[GAME] New secret number generated: {}", secret_number);
+}
+
+// Compare a guess with a secret (shared by every room)
+static const char* judgeGuess(int secret, int guess) {
+    if (guess == secret) {
+        return "WIN Correct! You guessed the number.";
+    }
+    else if (guess < secret) {
+        return "HIGHER! Guess higher!";
+    }
+    else {
+        return "LOWER! Guess lower!";
+    }
+}
+
+// Process a guess from a player
+static string processGuess(int player_id, int guess) {
+    if (secret_number == -1) {
+        generateSecretNumber();
+    }
+
+    if (guess == secret_number) {
+        winner_id = player_id;
+        player_scores[player_id]++;  // Increase score
+        
+        // Log win
+        LOG_INFO("[GAME] Player {} guessed {} and WON!", player_id, guess);
+    }
+    return judgeGuess(secret_number, guess);
+}
+
+// Start a new game
+static void startNewGame() {
+    generateSecretNumber();
+    winner_id = -1;
+    LOG_INFO("[GAME] New game started.");
+}
+
+/* =========================================================
+   =============== Member 3: Client Handler ================
+   ========================================================= */
+// Serve one player of a room. `st` is the room's state in shared memory
+// (mapped before fork); room -1 is the single-room server's FIFO naming.
+static void handleClient(SharedState* st, int room, int player_id) {
+    char fifo_name[100];
+    if (room < 0) {
+        snprintf(fifo_name, sizeof(fifo_name), "/tmp/guess_game_client_%d", player_id);
+    } else {
+        snprintf(fifo_name, sizeof(fifo_name), "/tmp/guess_game_client_%d_%d", room, player_id);
+    }
+
+    // Create FIFO for this client (server side)
+    unlink(fifo_name);
+    mkfifo(fifo_name, 0666);
+
+    // Open FIFO for reading guesses (non-blocking)
+    int fd = open(fifo_name, O_RDWR | O_NONBLOCK);
+
+    if (fd < 0) {
+        LOG_ERROR("[CLIENT] Failed to open FIFO for player {}", player_id);
+        return;
+    }
+
+    LOG_INFO("[CLIENT] Player {} connected via {}", player_id, fifo_name);
+
+    int last_seen = -1;     // seat whose turn this handler saw last
+    while (true) {
+        // Check game status + turn
+        stateLock(st);
+        int current_player = st->shared_int[0];
+        int game_over      = st->shared_int[3];
+        uint64_t turn_id   = st->trace_id;
+        int64_t turn_start = st->turn_start_ns;
+        pthread_mutex_unlock(&st->shared_mutex);
+
+        if (game_over == 1) break;
+
+        // The previous guess's path ends when this seat notices its turn
+        if (current_player != last_seen) {
+            if (current_player == player_id && turn_start) {
+                traceEnd("turn_visible", turn_id, turn_start, 'f');
+            }
+            last_seen = current_player;
+        }
+
+        LOG_DEBUG("[CLIENT] Player {}: my turn? current={}", player_id, current_player);
+
+        // Read client message (non-blocking)
+        char buffer[256];
+        memset(buffer, 0, sizeof(buffer));
+        int64_t t_read = traceBegin();
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+
+        if (n <= 0) {
+            // n == 0: no writer yet OR client closed; treat as "no input" for now
+            // n < 0 and errno==EAGAIN: no data (non-blocking), normal
+            traceFlush();
+            usleep(50 * 1000);
+            continue;
+        }
+
+        // Only "ASK_TURN <id>" and "GUESS <id> <guess> [trace id]" are
+        // requests. Our own replies come back through this same FIFO when
+        // the client has not read them yet; anything else is dropped
+        // unanswered, or the handler would keep replying to itself.
+        int sender, guess;
+        unsigned long long guess_id = 0;
+        bool ask      = sscanf(buffer, "ASK_TURN %d", &sender) == 1;
+        bool is_guess = !ask && sscanf(buffer, "GUESS %d %d %llu", &sender, &guess, &guess_id) >= 2;
+        if (!ask && !is_guess) {
+            usleep(50 * 1000);
+            continue;
+        }
+
+        LOG_DEBUG("[CLIENT] Player {} sent: {}", player_id, buffer);
+
+        // A request counts as activity; (re)join if not connected or evicted
+        stateLock(st);
+        st->last_active_ms[player_id] = monoMs();
+        bool joined = (st->shared_int[1] & (1 << player_id)) == 0;
+        st->shared_int[1] |= (1 << player_id);
+        pthread_mutex_unlock(&st->shared_mutex);
+
+        if (joined) {
+            printf("Player %d CONNECTED\n", player_id);
+            fflush(stdout);
+
+            LOG_INFO("[CLIENT] Player {} is connected", player_id);
+        }
+
+        // Every reply is followed by the poll sleep, which gives the client
+        // time to read it before this loop reads the FIFO again.
+
+        // ===== ASK_TURN HANDLER =====
+        if (ask) {
+            char msg[64];
+            if (current_player == player_id) {
+                snprintf(msg, sizeof(msg), "YES_YOUR_TURN");
+            } else {
+                snprintf(msg, sizeof(msg), "NO Player %d's turn", current_player);
+            }
+            write(fd, msg, strlen(msg) + 1);
+            LOG_DEBUG("[CLIENT] Player {} asked for turn -> {}", player_id, msg);
+            usleep(50 * 1000);
+            continue;  // Don't process as guess
+        }
+
+        // ===== GUESS HANDLER =====
+        // Older clients send no id; give the guess one here
+        if (trace_enabled && guess_id == 0) guess_id = traceNewId();
+        traceEnd("fifo_read", guess_id, t_read, 't');
+
+        // Only process if it's REALLY this player's turn. The scheduler can
+        // move the turn on (timeout, eviction) at any time, so the check,
+        // the judging and the move are one critical section.
+        string response;
+        bool won = false;
+        stateLock(st);
+        current_player = st->shared_int[0];
+        bool my_turn = current_player == player_id && st->shared_int[2] == 0 && st->shared_int[3] == 0;
+        if (my_turn) {
+            int64_t t_judge = traceBegin();
+            response = processGuess(player_id, guess);
+            traceEnd("processGuess", guess_id, t_judge, 't');
+            won = response.find("WIN") != string::npos;
+
+            st->shared_int[2] = 1;   // current player finished move
+            st->trace_id = guess_id;
+            st->turn_done_ns = traceBegin();
+            if (st->moves.count < MAX_MOVES) {
+                GameMove m = {(uint8_t)player_id, moveGuess(guess), 0,
+                              (uint32_t)(wallMs() - st->moves.start_ms)};
+                st->moves.list[st->moves.count++] = m;
+            }
+            if (won) {
+                st->winner = player_id;
+                st->shared_int[3] = 1;   // win -> end game
+            }
+        }
+        pthread_mutex_unlock(&st->shared_mutex);
+
+        if (!my_turn) {
+            char msg[64];
+            snprintf(msg, sizeof(msg), "REJECT Not your turn! Player %d's turn", current_player);
+            write(fd, msg, strlen(msg) + 1);
+            LOG_DEBUG("[CLIENT] Rejected guess from player {} (current={})", player_id, current_player);
+            usleep(50 * 1000);
+            continue;
+        }
+
+        LOG_INFO("[GAME] Player {} guess number {}", player_id, guess);
+
+        // Send response back (same FIFO, your current design)
+        int64_t t_write = traceBegin();
+        if (write(fd, response.c_str(), response.size() + 1) < 0) {
+            LOG_WARN("[CLIENT] Failed to write response to player {}", player_id);
+        }
+        traceEnd("response_write", guess_id, t_write, 't');
+
+        if (won) break;
+        usleep(50 * 1000);
+    }
+
+    stateLock(st);
+    st->shared_int[1] &= ~(1 << player_id);
+    pthread_mutex_unlock(&st->shared_mutex);
+
+    close(fd);
+    unlink(fifo_name);
+    traceFlush();
+
+    LOG_INFO("[CLIENT] Player {} disconnected", player_id);
+}
+
+// ====================== saveScores() ======================
+static void saveScores() {
+    FILE* fp = fopen(SCORE_FILE, "w");
+    if (!fp) return;
+
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        fprintf(fp, "%d\n", player_scores[i]);
+    }
+
+    fclose(fp);
+    LOG_INFO("[SCORE] Scores saved to file.");
+}
+
+
+/* =========================================================
+   =============== Member 4: Game History ==================
+   ========================================================= */
+// Finished games go to an append-only journal in history/: numbered
+// segment files (seg-N.log) of binary records, each with a side file
+// (seg-N.idx) holding one (player, offset) pair per player in a record.
+// The .idx files are loaded into a per-player offset index at startup, so
+// "last N games of player X" decodes exactly N records straight from the
+// mmap'ed segments. The game path only queues a GameRecord; a writer
+// thread encodes and appends it. When there are more than
+// HIST_MAX_SEGMENTS segments the two oldest are compacted into one,
+// keeping only games that are still among some player's last
+// HIST_KEEP_PER_PLAYER.
+
+static const char*    HISTORY_DIR          = "history";
+static const uint32_t HIST_MAGIC           = 0x31524847;   // "GHR1"
+static const size_t   HIST_SEGMENT_BYTES   = 4 << 20;
+static const size_t   HIST_MAX_SEGMENTS    = 8;
+static const size_t   HIST_KEEP_PER_PLAYER = 200;
+static const uint32_t HIST_NO_PLAYER       = 0xffffffffu;
+// Player ids: the single-room server's seats are players 0..3; seat s of
+// room r (multi servers, shards) is HIST_ROOM_PLAYERS + r * MAX_PLAYERS + s,
+// so the journals of both can be queried together.
+static const uint32_t HIST_ROOM_PLAYERS    = 1000;
+
+// On-disk record: this header, nmoves GameMove entries, then a checksum
+struct HistRecordHead {
+    uint32_t magic;
+    uint32_t length;            // whole record, checksum included
+    uint64_t game_id;
+    int64_t  start_ms;          // wall clock
+    uint32_t duration_ms;
+    int32_t  room;
+    uint32_t players[MAX_PLAYERS];  // player per seat, HIST_NO_PLAYER if empty
+    int8_t   winner;            // seat, -1 if the game was abandoned
+    uint8_t  nplayers;
+    uint16_t nmoves;
+    uint32_t reserved;
+};
+
+struct HistIndexEntry {
+    uint32_t player;
+    uint32_t offset;
+};
+
+struct GameRecord {
+    uint64_t game_id;           // assigned by the writer
+    int64_t  start_ms;
+    uint32_t duration_ms;
+    int32_t  room;
+    int      winner;
+    uint32_t players[MAX_PLAYERS];
+    vector<GameMove> moves;
+};
+
+struct HistSegment {
+    uint32_t id;
+    size_t   size;
+    void*    map;               // read-only mapping, grown on demand
+    size_t   map_len;
+};
+
+struct GameHistory {
+    string dir;
+
+    // Segments and index; queries and the writer both take this
+    pthread_mutex_t mutex;
+    vector<HistSegment> segments;                   // ascending id, last is active
+    unordered_map<uint32_t, vector<uint64_t> > index;   // player -> (seg << 32 | offset)
+
+    // Writer side
+    int seg_fd;
+    int idx_fd;
+    uint64_t next_game_id;
+    long written;
+    long compactions;
+
+    pthread_mutex_t q_mutex;
+    pthread_cond_t  q_cv;
+    queue<GameRecord> q;
+    bool running;
+    bool busy;                  // writer holds records taken off q
+    bool read_only;             // opened by historyOpenReader(): no writer
+    pthread_t tid;
+};
+
+static uint32_t histChecksum(const char* p, size_t len) {
+    uint32_t h = 2166136261u;   // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static string histPath(const GameHistory* h, uint32_t id, const char* ext) {
+    char name[32];
+    snprintf(name, sizeof(name), "/seg-%08u.%s", id, ext);
+    return h->dir + name;
+}
+
+static void histEncode(const GameRecord& g, string& out) {
+    HistRecordHead head;
+    memset(&head, 0, sizeof(head));
+    head.magic = HIST_MAGIC;
+    head.nmoves = (uint16_t)g.moves.size();
+    head.length = sizeof(head) + head.nmoves * sizeof(GameMove) + sizeof(uint32_t);
+    head.game_id = g.game_id;
+    head.start_ms = g.start_ms;
+    head.duration_ms = g.duration_ms;
+    head.room = g.room;
+    head.winner = (int8_t)g.winner;
+    for (int s = 0; s < MAX_PLAYERS; s++) {
+        head.players[s] = g.players[s];
+        if (g.players[s] != HIST_NO_PLAYER) head.nplayers++;
+    }
+
+    size_t start = out.size();
+    out.append((const char*)&head, sizeof(head));
+    if (head.nmoves) out.append((const char*)&g.moves[0], head.nmoves * sizeof(GameMove));
+    uint32_t sum = histChecksum(out.data() + start, out.size() - start);
+    out.append((const char*)&sum, sizeof(sum));
+}
+
+// Decode one record at p. Returns its length, or 0 if it is torn/corrupt.
+static size_t histDecode(const char* p, size_t avail, GameRecord* g) {
+    HistRecordHead head;
+    if (avail < sizeof(head) + sizeof(uint32_t)) return 0;
+    memcpy(&head, p, sizeof(head));
+    if (head.magic != HIST_MAGIC || head.length > avail ||
+        head.length != sizeof(head) + head.nmoves * sizeof(GameMove) + sizeof(uint32_t)) return 0;
+
+    uint32_t sum;
+    memcpy(&sum, p + head.length - sizeof(sum), sizeof(sum));
+    if (sum != histChecksum(p, head.length - sizeof(sum))) return 0;
+
+    if (g) {
+        g->game_id = head.game_id;
+        g->start_ms = head.start_ms;
+        g->duration_ms = head.duration_ms;
+        g->room = head.room;
+        g->winner = head.winner;
+        memcpy(g->players, head.players, sizeof(g->players));
+        g->moves.resize(head.nmoves);
+        if (head.nmoves) memcpy(&g->moves[0], p + sizeof(head), head.nmoves * sizeof(GameMove));
+    }
+    return head.length;
+}
+
+static void histIndexRecord(const char* rec, uint32_t offset, vector<HistIndexEntry>& out) {
+    HistRecordHead head;
+    memcpy(&head, rec, sizeof(head));
+    for (int s = 0; s < MAX_PLAYERS; s++) {
+        if (head.players[s] != HIST_NO_PLAYER) out.push_back(HistIndexEntry{head.players[s], offset});
+    }
+}
+
+static bool histReadFile(const string& path, string& out) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat sb;
+    fstat(fd, &sb);
+    out.resize(sb.st_size);
+    ssize_t n = sb.st_size ? read(fd, &out[0], sb.st_size) : 0;
+    close(fd);
+    if (n < 0) return false;
+    out.resize(n);
+    return true;
+}
+
+static HistSegment* histFindSegment(GameHistory* h, uint32_t id) {
+    size_t lo = 0, hi = h->segments.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (h->segments[mid].id < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return (lo < h->segments.size() && h->segments[lo].id == id) ? &h->segments[lo] : nullptr;
+}
+
+static void histUnmap(HistSegment* seg) {
+    if (seg->map) munmap(seg->map, seg->map_len);
+    seg->map = nullptr;
+    seg->map_len = 0;
+}
+
+// Pointer to `len` bytes at `offset` of a segment (caller holds h->mutex)
+static const char* histMapped(GameHistory* h, HistSegment* seg, size_t offset, size_t len) {
+    if (offset + len > seg->size) return nullptr;
+    if (offset + len > seg->map_len) {
+        histUnmap(seg);
+        int fd = open(histPath(h, seg->id, "log").c_str(), O_RDONLY);
+        if (fd < 0) return nullptr;
+        void* m = mmap(nullptr, seg->size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (m == MAP_FAILED) return nullptr;
+        seg->map = m;
+        seg->map_len = seg->size;
+    }
+    return (const char*)seg->map + offset;
+}
+
+// Add a segment's index entries behind what is already indexed
+static void histLoadIndex(GameHistory* h, uint32_t id, const vector<HistIndexEntry>& entries) {
+    for (size_t i = 0; i < entries.size(); i++) {
+        h->index[entries[i].player].push_back(((uint64_t)id << 32) | entries[i].offset);
+    }
+}
+
+// Rescan a segment: rebuild its index and cut off a torn tail
+static size_t histRecoverSegment(GameHistory* h, uint32_t id, vector<HistIndexEntry>& entries,
+                                 uint64_t* last_game_id) {
+    string data;
+    if (!histReadFile(histPath(h, id, "log"), data)) return 0;
+
+    size_t off = 0;
+    GameRecord g;
+    while (off < data.size()) {
+        size_t len = histDecode(data.data() + off, data.size() - off, &g);
+        if (len == 0) break;
+        histIndexRecord(data.data() + off, (uint32_t)off, entries);
+        if (g.game_id > *last_game_id) *last_game_id = g.game_id;
+        off += len;
+    }
+
+    if (off != data.size()) {
+        LOG_WARN("[HISTORY] Segment {}: dropped {} torn bytes", id, data.size() - off);
+        truncate(histPath(h, id, "log").c_str(), off);
+    }
+
+    int fd = open(histPath(h, id, "idx").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd >= 0) {
+        if (!entries.empty()) write(fd, &entries[0], entries.size() * sizeof(HistIndexEntry));
+        close(fd);
+    }
+    return off;
+}
+
+static bool histOpenActive(GameHistory* h, uint32_t id) {
+    h->seg_fd = open(histPath(h, id, "log").c_str(), O_WRONLY | O_CREAT | O_APPEND, 0666);
+    h->idx_fd = open(histPath(h, id, "idx").c_str(), O_WRONLY | O_CREAT | O_APPEND, 0666);
+    return h->seg_fd >= 0 && h->idx_fd >= 0;
+}
+
+// Merge the two oldest segments into the first, dropping games no player
+// needs any more. Only the writer thread calls this, and never on the
+// active segment.
+static void histCompactOldest(GameHistory* h) {
+    pthread_mutex_lock(&h->mutex);
+    HistSegment a = h->segments[0];
+    HistSegment b = h->segments[1];
+
+    // Per player, the oldest location that is still among its last KEEP
+    unordered_map<uint32_t, uint64_t> keep_from;
+    for (auto it = h->index.begin(); it != h->index.end(); ++it) {
+        const vector<uint64_t>& locs = it->second;
+        keep_from[it->first] = locs.size() > HIST_KEEP_PER_PLAYER
+                             ? locs[locs.size() - HIST_KEEP_PER_PLAYER] : 0;
+    }
+    pthread_mutex_unlock(&h->mutex);
+
+    // Sealed segments never change, so they can be read without the lock
+    string out;
+    vector<HistIndexEntry> entries;
+    long kept = 0, dropped = 0;
+    const HistSegment* parts[2] = {&a, &b};
+    for (int k = 0; k < 2; k++) {
+        string data;
+        histReadFile(histPath(h, parts[k]->id, "log"), data);
+
+        size_t off = 0;
+        while (off < data.size()) {
+            const char* rec = data.data() + off;
+            size_t len = histDecode(rec, data.size() - off, nullptr);
+            if (len == 0) break;
+
+            HistRecordHead head;
+            memcpy(&head, rec, sizeof(head));
+            uint64_t loc = ((uint64_t)parts[k]->id << 32) | off;
+            bool live = false;
+            for (int s = 0; s < MAX_PLAYERS && !live; s++) {
+                if (head.players[s] != HIST_NO_PLAYER) live = loc >= keep_from[head.players[s]];
+            }
+
+            if (live) {
+                histIndexRecord(rec, (uint32_t)out.size(), entries);
+                out.append(rec, len);
+                kept++;
+            } else {
+                dropped++;
+            }
+            off += len;
+        }
+    }
+
+    // Write the merged segment next to the old one, then swap it in
+    string tmp_log = histPath(h, a.id, "log.tmp");
+    string tmp_idx = histPath(h, a.id, "idx.tmp");
+    int fd = open(tmp_log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    int ifd = open(tmp_idx.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    bool ok = fd >= 0 && ifd >= 0 &&
+              write(fd, out.data(), out.size()) == (ssize_t)out.size() &&
+              (entries.empty() ||
+               write(ifd, &entries[0], entries.size() * sizeof(HistIndexEntry)) ==
+                   (ssize_t)(entries.size() * sizeof(HistIndexEntry)));
+    if (fd >= 0) close(fd);
+    if (ifd >= 0) close(ifd);
+    if (!ok) {
+        unlink(tmp_log.c_str());
+        unlink(tmp_idx.c_str());
+        LOG_ERROR("[HISTORY] Compaction of segment {} failed", a.id);
+        return;
+    }
+
+    pthread_mutex_lock(&h->mutex);
+    histUnmap(&h->segments[0]);
+    histUnmap(&h->segments[1]);
+    rename(tmp_log.c_str(), histPath(h, a.id, "log").c_str());
+    rename(tmp_idx.c_str(), histPath(h, a.id, "idx").c_str());
+    unlink(histPath(h, b.id, "log").c_str());
+    unlink(histPath(h, b.id, "idx").c_str());
+
+    h->segments.erase(h->segments.begin() + 1);
+    h->segments[0].size = out.size();
+    if (out.empty()) {
+        unlink(histPath(h, a.id, "log").c_str());
+        unlink(histPath(h, a.id, "idx").c_str());
+        h->segments.erase(h->segments.begin());
+    }
+
+    // Both segments were the oldest, so their entries lead every list
+    uint64_t end = ((uint64_t)b.id + 1) << 32;
+    for (auto it = h->index.begin(); it != h->index.end(); ) {
+        vector<uint64_t>& locs = it->second;
+        size_t n = 0;
+        while (n < locs.size() && locs[n] < end) n++;
+        locs.erase(locs.begin(), locs.begin() + n);
+        if (locs.empty()) it = h->index.erase(it);
+        else ++it;
+    }
+    unordered_map<uint32_t, vector<uint64_t> > merged;
+    for (size_t i = 0; i < entries.size(); i++) {
+        merged[entries[i].player].push_back(((uint64_t)a.id << 32) | entries[i].offset);
+    }
+    for (auto it = merged.begin(); it != merged.end(); ++it) {
+        vector<uint64_t>& locs = h->index[it->first];
+        locs.insert(locs.begin(), it->second.begin(), it->second.end());
+    }
+    h->compactions++;
+    pthread_mutex_unlock(&h->mutex);
+
+    LOG_INFO("[HISTORY] Compacted segments {}+{}: kept {} games, dropped {}", a.id, b.id, kept, dropped);
+}
+
+// Seal the active segment and start the next one
+static void histRoll(GameHistory* h) {
+    close(h->seg_fd);
+    close(h->idx_fd);
+
+    pthread_mutex_lock(&h->mutex);
+    uint32_t id = h->segments.back().id + 1;
+    h->segments.push_back(HistSegment{id, 0, nullptr, 0});
+    pthread_mutex_unlock(&h->mutex);
+
+    if (!histOpenActive(h, id)) LOG_ERROR("[HISTORY] Cannot open segment {}", id);
+
+    while (h->segments.size() > HIST_MAX_SEGMENTS) {
+        size_t before = h->segments.size();
+        histCompactOldest(h);
+        if (h->segments.size() == before) break;   // compaction failed
+    }
+}
+
+static void histWrite(GameHistory* h, GameRecord& g) {
+    g.game_id = h->next_game_id++;
+
+    string rec;
+    histEncode(g, rec);
+    if (h->segments.back().size > 0 && h->segments.back().size + rec.size() > HIST_SEGMENT_BYTES) {
+        histRoll(h);
+    }
+
+    uint32_t offset = (uint32_t)h->segments.back().size;
+    vector<HistIndexEntry> entries;
+    histIndexRecord(rec.data(), offset, entries);
+
+    if (entries.empty()) return;
+    if (write(h->seg_fd, rec.data(), rec.size()) != (ssize_t)rec.size()) {
+        LOG_ERROR("[HISTORY] Failed to append game {}", g.game_id);
+        return;
+    }
+    write(h->idx_fd, &entries[0], entries.size() * sizeof(HistIndexEntry));
+
+    pthread_mutex_lock(&h->mutex);
+    h->segments.back().size += rec.size();
+    histLoadIndex(h, h->segments.back().id, entries);
+    h->written++;
+    pthread_mutex_unlock(&h->mutex);
+}
+
+static void* historyThread(void* arg) {
+    GameHistory* h = (GameHistory*)arg;
+    queue<GameRecord> batch;
+
+    while (true) {
+        pthread_mutex_lock(&h->q_mutex);
+        h->busy = false;
+        pthread_cond_broadcast(&h->q_cv);
+        while (h->q.empty() && h->running) {
+            pthread_cond_wait(&h->q_cv, &h->q_mutex);
+        }
+        if (!h->running && h->q.empty()) {
+            pthread_mutex_unlock(&h->q_mutex);
+            break;
+        }
+        batch.swap(h->q);
+        h->busy = true;
+        pthread_mutex_unlock(&h->q_mutex);
+
+        while (!batch.empty()) {
+            histWrite(h, batch.front());
+            batch.pop();
+        }
+    }
+    return nullptr;
+}
+
+// Segment ids present in dir, ascending
+static bool histListSegments(const char* dir, vector<uint32_t>& ids) {
+    DIR* d = opendir(dir);
+    if (!d) return false;
+    while (dirent* e = readdir(d)) {
+        unsigned id;
+        char ext[8];
+        if (sscanf(e->d_name, "seg-%u.%7s", &id, ext) == 2 && strcmp(ext, "log") == 0) ids.push_back(id);
+    }
+    closedir(d);
+    sort(ids.begin(), ids.end());
+    return true;
+}
+
+static void histInit(GameHistory* h, const char* dir, bool read_only) {
+    h->dir = dir;
+    pthread_mutex_init(&h->mutex, nullptr);
+    pthread_mutex_init(&h->q_mutex, nullptr);
+    pthread_cond_init(&h->q_cv, nullptr);
+    h->seg_fd = h->idx_fd = -1;
+    h->next_game_id = 1;
+    h->written = h->compactions = 0;
+    h->running = !read_only;
+    h->busy = false;
+    h->read_only = read_only;
+}
+
+// Open (or create) the journal in dir and start its writer thread
+static bool historyOpen(GameHistory* h, const char* dir) {
+    mkdir(dir, 0777);
+    histInit(h, dir, false);
+
+    vector<uint32_t> ids;
+    if (!histListSegments(dir, ids)) return false;
+
+    // Sealed segments are trusted through their .idx; the last one may
+    // have been cut short and is rescanned
+    uint64_t last_game_id = 0;
+    vector<int64_t> newest(ids.size(), -1);
+    for (size_t i = 0; i < ids.size(); i++) {
+        vector<HistIndexEntry> entries;
+        size_t size;
+        if (i + 1 == ids.size()) {
+            size = histRecoverSegment(h, ids[i], entries, &last_game_id);
+        } else {
+            string raw;
+            histReadFile(histPath(h, ids[i], "idx"), raw);
+            entries.resize(raw.size() / sizeof(HistIndexEntry));
+            if (!entries.empty()) memcpy(&entries[0], raw.data(), entries.size() * sizeof(HistIndexEntry));
+            struct stat sb;
+            size = stat(histPath(h, ids[i], "log").c_str(), &sb) == 0 ? sb.st_size : 0;
+        }
+        if (!entries.empty()) newest[i] = entries.back().offset;
+        h->segments.push_back(HistSegment{ids[i], size, nullptr, 0});
+        histLoadIndex(h, ids[i], entries);
+    }
+
+    // An empty active segment says nothing about ids: use the newest record
+    for (size_t i = ids.size(); i-- > 0 && last_game_id == 0; ) {
+        if (newest[i] < 0) continue;
+        GameRecord g;
+        HistSegment* seg = &h->segments[i];
+        const char* p = histMapped(h, seg, newest[i], sizeof(HistRecordHead));
+        if (p && histDecode(p, seg->size - newest[i], &g)) last_game_id = g.game_id;
+        break;
+    }
+    h->next_game_id = last_game_id + 1;
+
+    if (h->segments.empty()) h->segments.push_back(HistSegment{1, 0, nullptr, 0});
+    if (!histOpenActive(h, h->segments.back().id)) return false;
+
+    pthread_create(&h->tid, nullptr, historyThread, h);
+    LOG_INFO("[HISTORY] Opened {}: {} segments, {} players indexed",
+             dir, h->segments.size(), h->index.size());
+    return true;
+}
+
+// Open an existing journal for queries only. Nothing on disk is touched
+// and no writer starts, so this is safe next to a running server. Every
+// segment, the active one included, is indexed from its .idx; entries
+// whose record is not complete yet simply fail to decode.
+static bool historyOpenReader(GameHistory* h, const char* dir) {
+    histInit(h, dir, true);
+
+    vector<uint32_t> ids;
+    if (!histListSegments(dir, ids)) return false;
+    for (size_t i = 0; i < ids.size(); i++) {
+        string raw;
+        histReadFile(histPath(h, ids[i], "idx"), raw);
+        vector<HistIndexEntry> entries(raw.size() / sizeof(HistIndexEntry));
+        if (!entries.empty()) memcpy(&entries[0], raw.data(), entries.size() * sizeof(HistIndexEntry));
+        struct stat sb;
+        size_t size = stat(histPath(h, ids[i], "log").c_str(), &sb) == 0 ? sb.st_size : 0;
+        h->segments.push_back(HistSegment{ids[i], size, nullptr, 0});
+        histLoadIndex(h, ids[i], entries);
+    }
+    return true;
+}
+
+// Queue a finished game (game path: no I/O, no encoding)
+static void historyAppend(GameHistory* h, const GameRecord& g) {
+    pthread_mutex_lock(&h->q_mutex);
+    h->q.push(g);
+    pthread_cond_signal(&h->q_cv);
+    pthread_mutex_unlock(&h->q_mutex);
+}
+
+// Wait until everything queued so far is on disk
+static void historyFlush(GameHistory* h) {
+    pthread_mutex_lock(&h->q_mutex);
+    while (!h->q.empty() || h->busy) {
+        pthread_cond_wait(&h->q_cv, &h->q_mutex);
+    }
+    pthread_mutex_unlock(&h->q_mutex);
+}
+
+// Up to n most recent games of a player, newest first
+static size_t historyLastGames(GameHistory* h, uint32_t player, size_t n, vector<GameRecord>& out) {
+    out.clear();
+    pthread_mutex_lock(&h->mutex);
+    auto it = h->index.find(player);
+    if (it != h->index.end()) {
+        const vector<uint64_t>& locs = it->second;
+        for (size_t k = locs.size(); k-- > 0 && out.size() < n; ) {
+            HistSegment* seg = histFindSegment(h, (uint32_t)(locs[k] >> 32));
+            uint32_t off = (uint32_t)locs[k];
+            const char* p = seg ? histMapped(h, seg, off, sizeof(HistRecordHead)) : nullptr;
+            if (!p) continue;
+
+            // A reader's .idx can predate a compaction: the offset may now
+            // hold another game, so keep it only if the player is in it
+            out.push_back(GameRecord());
+            GameRecord& g = out.back();
+            bool mine = false;
+            if (histDecode(p, seg->map_len - off, &g)) {
+                for (int s = 0; s < MAX_PLAYERS; s++) mine |= g.players[s] == player;
+            }
+            if (!mine) out.pop_back();
+        }
+    }
+    pthread_mutex_unlock(&h->mutex);
+    return out.size();
+}
+
+// Drain the queue, stop the writer and release everything
+static void historyClose(GameHistory* h) {
+    if (h->read_only) {
+        for (size_t i = 0; i < h->segments.size(); i++) histUnmap(&h->segments[i]);
+        h->segments.clear();
+        h->index.clear();
+        return;
+    }
+
+    pthread_mutex_lock(&h->q_mutex);
+    h->running = false;
+    pthread_cond_signal(&h->q_cv);
+    pthread_mutex_unlock(&h->q_mutex);
+    pthread_join(h->tid, nullptr);
+
+    close(h->seg_fd);
+    close(h->idx_fd);
+    for (size_t i = 0; i < h->segments.size(); i++) histUnmap(&h->segments[i]);
+    h->segments.clear();
+    h->index.clear();
+    LOG_INFO("[HISTORY] Closed after {} games ({} compactions).", h->written, h->compactions);
+}
+
+static uint32_t histRoomFirstPlayer(int room) {
+    return HIST_ROOM_PLAYERS + (uint32_t)room * MAX_PLAYERS;
+}
+
+// Build the journal record for a game held in a SharedState
+static void historyRecordGame(GameHistory* h, const SharedState* st, int room, uint32_t first_player) {
+    if (!h || st->moves.count == 0) return;
+
+    GameRecord g;
+    g.game_id = 0;
+    g.start_ms = st->moves.start_ms;
+    g.duration_ms = (uint32_t)(wallMs() - st->moves.start_ms);
+    g.room = room;
+    g.winner = st->winner;
+    for (int s = 0; s < MAX_PLAYERS; s++) g.players[s] = HIST_NO_PLAYER;
+    g.moves.assign(st->moves.list, st->moves.list + st->moves.count);
+    for (size_t i = 0; i < g.moves.size(); i++) {
+        g.players[g.moves[i].seat] = first_player + g.moves[i].seat;
+    }
+    historyAppend(h, g);
+}
+
+static bool histNewerFirst(const GameRecord& a, const GameRecord& b) {
+    return a.start_ms > b.start_ms;
+}
+
+// "./server history <player> [n] [dir]": print a player's last n games.
+// Reads the journal in dir and in the per-server sNN/ journals of
+// "./server multi" below it, without disturbing a server writing them.
+// Player ids are as in HIST_ROOM_PLAYERS: 0..3, or 1000 + room * 4 + seat.
+static int historyQuery(uint32_t player, size_t n, const char* dir) {
+    vector<string> dirs(1, dir);
+    if (DIR* d = opendir(dir)) {
+        while (dirent* e = readdir(d)) {
+            unsigned slot;
+            char tail;
+            if (sscanf(e->d_name, "s%u%c", &slot, &tail) == 1) dirs.push_back(string(dir) + "/" + e->d_name);
+        }
+        closedir(d);
+    }
+
+    vector<GameRecord> games, part;
+    for (size_t i = 0; i < dirs.size(); i++) {
+        GameHistory h;
+        if (!historyOpenReader(&h, dirs[i].c_str())) continue;
+        historyLastGames(&h, player, n, part);
+        games.insert(games.end(), part.begin(), part.end());
+        historyClose(&h);
+    }
+    sort(games.begin(), games.end(), histNewerFirst);
+    if (games.size() > n) games.resize(n);
+
+    printf("player %u: %zu games\n", player, games.size());
+    for (size_t i = 0; i < games.size(); i++) {
+        const GameRecord& g = games[i];
+        char when[64];
+        formatTime((time_t)(g.start_ms / 1000), when, sizeof(when));
+        int seat = 0;
+        while (seat < MAX_PLAYERS && g.players[seat] != player) seat++;
+
+        const char* result = g.winner < 0 ? "abandoned" : g.winner == seat ? "won" : "lost";
+        printf("  %s  room %d  game %llu  %.1fs  %s  guesses:", when, g.room,
+               (unsigned long long)g.game_id, g.duration_ms / 1000.0, result);
+        for (size_t k = 0; k < g.moves.size(); k++) {
+            if (g.moves[k].seat == seat) printf(" %u", g.moves[k].guess);
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+// SIGINT handler :only notify the program that it should terminate, no direct save data
+// SIGINT handler: only notify program to stop
+static void sigintHandler(int) {
+    g_stop = 1;
+}
+
+
+// Reset game state but keep scores
+static void resetGameState(SharedState* st) {
+    stateLock(st);
+    st->shared_int[0] = 0;
+    st->shared_int[2] = -1;
+    st->shared_int[3] = 0;
+    pthread_mutex_unlock(&st->shared_mutex);
+
+    LOG_INFO("[GAME] Game state reset. Scores preserved.");
+}
+
+/* =========================================================
+   =================== Existing Code =======================
+   ========================================================= */
+
+static void formatTime(time_t t, char* buf, size_t len);
+
+// Helper: current time string
+static string nowString() {
+    char buf[64];
+    formatTime(time(nullptr), buf, sizeof(buf));
+    return string(buf);
+}
+
+// Format a time_t the same way nowString() does
+static void formatTime(time_t t, char* buf, size_t len) {
+    tm tm{};
+    localtime_r(&t, &tm);
+    snprintf(buf, len, "%04d-%02d-%02d %02d:%02d:%02d",
+                  tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                  tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
+
+// ---------------------------
+// Log argument capture
+// ---------------------------
+// Each argument is stored as one tag byte followed by its raw bytes.
+// Strings are truncated so one record never exceeds LOG_ARG_BYTES.
+enum { LOG_ARG_INT = 'i', LOG_ARG_UINT = 'u', LOG_ARG_DBL = 'd', LOG_ARG_STR = 's' };
+
+static void logPackRaw(LogRecord& r, char tag, const void* p, size_t len) {
+    if (r.used + 1 + len > (size_t)LOG_ARG_BYTES) return;
+    r.args[r.used++] = tag;
+    memcpy(r.args + r.used, p, len);
+    r.used += len;
+    r.nargs++;
+}
+
+static inline void logPackOne(LogRecord& r, long long v)          { logPackRaw(r, LOG_ARG_INT, &v, sizeof(v)); }
+static inline void logPackOne(LogRecord& r, unsigned long long v) { logPackRaw(r, LOG_ARG_UINT, &v, sizeof(v)); }
+static inline void logPackOne(LogRecord& r, int v)                { logPackOne(r, (long long)v); }
+static inline void logPackOne(LogRecord& r, long v)               { logPackOne(r, (long long)v); }
+static inline void logPackOne(LogRecord& r, unsigned v)           { logPackOne(r, (unsigned long long)v); }
+static inline void logPackOne(LogRecord& r, unsigned long v)      { logPackOne(r, (unsigned long long)v); }
+static inline void logPackOne(LogRecord& r, double v)             { logPackRaw(r, LOG_ARG_DBL, &v, sizeof(v)); }
+
+static inline void logPackOne(LogRecord& r, const char* s) {
+    size_t room = LOG_ARG_BYTES - r.used;
+    if (room < 3) return;                        // tag + length + at least nothing
+    size_t len = strlen(s);
+    if (len > room - 2) len = room - 2;
+    if (len > 255) len = 255;
+    r.args[r.used++] = LOG_ARG_STR;
+    r.args[r.used++] = (char)(unsigned char)len;
+    memcpy(r.args + r.used, s, len);
+    r.used += len;
+    r.nargs++;
+}
+
+static inline void logPackOne(LogRecord& r, const string& s) { logPackOne(r, s.c_str()); }
+
+#if LOG_LEVEL < LOG_LEVEL_OFF
+static void logPack(LogRecord&) {}
+#endif
+
+template<typename T, typename... Rest>
+static void logPack(LogRecord& r, const T& v, const Rest&... rest) {
+    logPackOne(r, v);
+    logPack(r, rest...);
+}
+
+// Enqueue a record (thread-safe). Formatting happens in loggerThread().
+template<typename... Args>
+static void logRecord(int level, const char* fmt, const Args&... args) {
+    LogRecord r;
+    r.fmt   = fmt;
+    r.ts    = time(nullptr);
+    r.level = (unsigned char)level;
+    r.nargs = 0;
+    r.used  = 0;
+    logPack(r, args...);
+
+    size_t len = offsetof(LogRecord, args) + r.used;
+
+    pthread_mutex_lock(&log_mutex);
+    if (log_head - log_tail == (unsigned)LOG_RING_SIZE) {
+        log_dropped++;
+    } else {
+        memcpy(&log_ring[log_head % LOG_RING_SIZE], &r, len);
+        // The logger only sleeps on an empty ring
+        if (log_head++ == log_tail) pthread_cond_signal(&log_cv);
+    }
+    pthread_mutex_unlock(&log_mutex);
+}
+
+// Render a record into buf: "<time> <fmt with {} replaced>"
+static size_t logFormat(const LogRecord& r, char* buf, size_t len) {
+    formatTime(r.ts, buf, len);
+    size_t out = strlen(buf);
+    if (out < len - 1) buf[out++] = ' ';
+
+    size_t pos = 0;
+    for (const char* f = r.fmt; *f && out < len - 1; f++) {
+        if (f[0] != '{' || f[1] != '}' || pos >= r.used) {
+            buf[out++] = *f;
+            continue;
+        }
+        f++;
+
+        char tag = r.args[pos++];
+        int w = 0;
+        if (tag == LOG_ARG_INT) {
+            long long v;
+            memcpy(&v, r.args + pos, sizeof(v));
+            pos += sizeof(v);
+            w = snprintf(buf + out, len - out, "%lld", v);
+        } else if (tag == LOG_ARG_UINT) {
+            unsigned long long v;
+            memcpy(&v, r.args + pos, sizeof(v));
+            pos += sizeof(v);
+            w = snprintf(buf + out, len - out, "%llu", v);
+        } else if (tag == LOG_ARG_DBL) {
+            double v;
+            memcpy(&v, r.args + pos, sizeof(v));
+            pos += sizeof(v);
+            w = snprintf(buf + out, len - out, "%g", v);
+        } else {
+            int n = (unsigned char)r.args[pos++];
+            w = snprintf(buf + out, len - out, "%.*s", n, r.args + pos);
+            pos += n;
+        }
+        if (w > 0) out += ((size_t)w < len - out) ? (size_t)w : len - out - 1;
+    }
+    buf[out] = '\0';
+    return out;
+}
+
+// ---------------------------
+// Hierarchical Timing Wheel
+// ---------------------------
+// One wheel serves every timer in the scheduler: turn deadlines and idle
+// checks for all players of all rooms. Four levels of 256 slots cover 2^32
+// ticks; a timer is parked in the coarsest level that fits its delay and
+// cascades down as the wheel turns, so arm/cancel are O(1) and each tick
+// only touches the slot that is due.
+static const int  SCHED_TICK_MS = 10;
+static const int  WHEEL_BITS    = 8;
+static const int  WHEEL_SLOTS   = 1 << WHEEL_BITS;
+static const int  WHEEL_MASK    = WHEEL_SLOTS - 1;
+static const int  WHEEL_LEVELS  = 4;
+
+typedef void (*TimerFn)(void* arg, int data);
+
+struct TimerNode {
+    TimerNode* prev;
+    TimerNode* next;        // nullptr when not armed
+    uint64_t   expires;     // absolute tick
+    TimerFn    fn;
+    void*      arg;
+    int        data;
+};
+
+struct TimerWheel {
+    uint64_t  now;          // ticks elapsed
+    uint64_t  next;         // next tick to run (at most now + 1)
+    size_t    armed;
+    TimerNode slots[WHEEL_LEVELS][WHEEL_SLOTS];   // list heads
+};
+
+static void listInit(TimerNode* head) {
+    head->prev = head->next = head;
+}
+
+static void wheelInit(TimerWheel* w) {
+    w->now = 0;
+    w->next = 1;
+    w->armed = 0;
+    for (int l = 0; l < WHEEL_LEVELS; l++)
+        for (int s = 0; s < WHEEL_SLOTS; s++) listInit(&w->slots[l][s]);
+}
+
+static void timerInit(TimerNode* t, TimerFn fn, void* arg, int data) {
+    t->prev = t->next = nullptr;
+    t->expires = 0;
+    t->fn = fn;
+    t->arg = arg;
+    t->data = data;
+}
+
+static bool timerPending(const TimerNode* t) {
+    return t->next != nullptr;
+}
+
+// Link t into the slot matching its expiry, relative to the next tick to run
+static void wheelPlace(TimerWheel* w, TimerNode* t) {
+    uint64_t delta = t->expires - w->next;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= ((uint64_t)1 << (WHEEL_BITS * (level + 1))))
+        level++;
+
+    if (delta >= ((uint64_t)1 << (WHEEL_BITS * WHEEL_LEVELS))) {
+        // Beyond the wheel: park in the last slot, it cascades back in time
+        t->expires = w->next + ((uint64_t)1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    }
+
+    TimerNode* head = &w->slots[level][(t->expires >> (WHEEL_BITS * level)) & WHEEL_MASK];
+    t->prev = head->prev;
+    t->next = head;
+    head->prev->next = t;
+    head->prev = t;
+}
+
+static void timerCancel(TimerWheel* w, TimerNode* t) {
+    if (!timerPending(t)) return;
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->prev = t->next = nullptr;
+    w->armed--;
+}
+
+// (Re)arm t to fire `ticks` ticks from now (at least one)
+static void timerArm(TimerWheel* w, TimerNode* t, uint64_t ticks) {
+    timerCancel(w, t);
+    t->expires = w->now + (ticks ? ticks : 1);
+    wheelPlace(w, t);
+    w->armed++;
+}
+
+// Move every timer of one upper-level slot down to where it now belongs
+static int wheelCascade(TimerWheel* w, int level) {
+    int index = (w->next >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    TimerNode* head = &w->slots[level][index];
+
+    TimerNode* t = head->next;
+    listInit(head);
+    while (t != head) {
+        TimerNode* nxt = t->next;
+        wheelPlace(w, t);
+        t = nxt;
+    }
+    return index;
+}
+
+// Advance the wheel by `ticks` and run everything that became due.
+// Callbacks may arm or cancel any timer, including themselves.
+static void wheelAdvance(TimerWheel* w, uint64_t ticks) {
+    w->now += ticks;
+
+    while (w->next <= w->now) {
+        int index = w->next & WHEEL_MASK;
+        if (index == 0) {
+            for (int l = 1; l < WHEEL_LEVELS && wheelCascade(w, l) == 0; l++) {}
+        }
+
+        TimerNode due;
+        TimerNode* head = &w->slots[0][index];
+        if (head->next == head) {
+            w->next++;
+            continue;
+        }
+        due.next = head->next;
+        due.prev = head->prev;
+        due.next->prev = &due;
+        due.prev->next = &due;
+        listInit(head);
+        w->next++;
+
+        while (due.next != &due) {
+            TimerNode* t = due.next;
+            timerCancel(w, t);
+            t->fn(t->arg, t->data);
+        }
+    }
+}
+
+// A fresh wheel and the timerfd that clocks it, one tick per SCHED_TICK_MS.
+// Returns the fd, or -1 (and no wheel) if the timer cannot be set up.
+static int wheelClockOpen(TimerWheel** wheel, int flags) {
+    *wheel = nullptr;
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | flags);
+    if (tfd < 0) {
+        LOG_ERROR("[SCHED] timerfd_create failed: {}", strerror(errno));
+        return -1;
+    }
+    itimerspec its{};
+    its.it_interval.tv_nsec = SCHED_TICK_MS * 1000000L;
+    its.it_value = its.it_interval;
+    if (timerfd_settime(tfd, 0, &its, nullptr) < 0) {
+        LOG_ERROR("[SCHED] timerfd_settime failed: {}", strerror(errno));
+        close(tfd);
+        return -1;
+    }
+
+    *wheel = new TimerWheel;
+    wheelInit(*wheel);
+    return tfd;
+}
+
+// ---------------------------
+// Round Robin Scheduler Thread
+// ---------------------------
+struct SchedulerArgs {
+    SharedState* st;
+    int quantum_ms;     // turn deadline
+    int idle_ms;        // evict a player silent for this long
+    GameHistory* history;   // finished game goes here (may be null)
+};
+
+static int findNextConnected(int current, int connected_mask) {
+    if (connected_mask == 0) return -1; // nobody connected
+
+    for (int step = 1; step <= MAX_PLAYERS; step++) {
+        int next = (current + step) % MAX_PLAYERS;
+        if (connected_mask & (1 << next)) return next;
+    }
+
+    // If we get here, it means ONLY current is connected (or mask weird)
+    if (connected_mask & (1 << current)) return current;
+    return -1;
+}
+
+// Scheduler-side view of one room: its timers and what it last saw
+struct RoomSched {
+    SharedState* st;
+    TimerWheel*  wheel;
+    int quantum_ticks;
+    int idle_ticks;
+    int known_mask;                     // players with an idle timer armed
+    TimerNode turn_timer;               // data = player whose turn it is
+    TimerNode idle_timer[MAX_PLAYERS];  // data = player
+};
+
+// Turn deadline passed: hand the turn to the next connected player
+static void onTurnTimeout(void* arg, int player) {
+    RoomSched* r = (RoomSched*)arg;
+    SharedState* st = r->st;
+
+    stateLock(st);
+    bool still_current = st->shared_int[3] == 0 && st->shared_int[0] == player;
+    int next = -1;
+    if (still_current) {
+        next = findNextConnected(player, st->shared_int[1]);
+        if (next != -1) st->shared_int[0] = next;
+        st->shared_int[2] = 0;
+        // No guess handed this turn on: the last one's flow already ended
+        st->trace_id = 0;
+        st->turn_done_ns = 0;
+        st->turn_start_ns = 0;
+    }
+    pthread_mutex_unlock(&st->shared_mutex);
+
+    if (still_current) {
+        // A lone player just keeps the turn
+        if (next != player) LOG_INFO("[SCHED] Player {} turn timed out", player);
+        r->turn_timer.data = -1;    // roomStep() re-arms for the new holder
+    }
+}
+
+// Idle check: evict the player if its last request is idle_ms old,
+// otherwise check again exactly when it will be
+static void onIdleTimeout(void* arg, int player) {
+    RoomSched* r = (RoomSched*)arg;
+    SharedState* st = r->st;
+    int64_t idle_ms = (int64_t)r->idle_ticks * SCHED_TICK_MS;
+
+    stateLock(st);
+    int64_t quiet = monoMs() - st->last_active_ms[player];
+    bool idle = quiet >= idle_ms;
+    if (idle) st->shared_int[1] &= ~(1 << player);
+    pthread_mutex_unlock(&st->shared_mutex);
+
+    if (!idle) {
+        int64_t left = (idle_ms - quiet + SCHED_TICK_MS - 1) / SCHED_TICK_MS;
+        timerArm(r->wheel, &r->idle_timer[player], (int)left);
+        return;
+    }
+
+    r->known_mask &= ~(1 << player);
+    LOG_INFO("[SCHED] Player {} idle for {} ms, evicted", player, r->idle_ticks * SCHED_TICK_MS);
+}
+
+static void roomInit(RoomSched* r, SharedState* st, TimerWheel* wheel, int quantum_ms, int idle_ms) {
+    r->st = st;
+    r->wheel = wheel;
+    r->quantum_ticks = quantum_ms / SCHED_TICK_MS;
+    r->idle_ticks = idle_ms / SCHED_TICK_MS;
+    r->known_mask = 0;
+    timerInit(&r->turn_timer, onTurnTimeout, r, -1);
+    for (int p = 0; p < MAX_PLAYERS; p++) {
+        timerInit(&r->idle_timer[p], onIdleTimeout, r, p);
+    }
+}
+
+static void roomCancelTimers(RoomSched* r) {
+    timerCancel(r->wheel, &r->turn_timer);
+    for (int p = 0; p < MAX_PLAYERS; p++) timerCancel(r->wheel, &r->idle_timer[p]);
+    r->known_mask = 0;
+}
+
+// One scheduling pass over a room. Returns false once its game is over.
+static bool roomStep(RoomSched* r) {
+    SharedState* st = r->st;
+    bool new_turn = false;
+
+    stateLock(st);
+
+    int game_status    = st->shared_int[3];
+    int current_player = st->shared_int[0];
+    int connected_mask = st->shared_int[1];
+    int turn_done      = st->shared_int[2];
+
+    if (game_status != 0) {
+        pthread_mutex_unlock(&st->shared_mutex);
+        roomCancelTimers(r);
+        return false;
+    }
+
+    if (connected_mask != 0) {
+        // current not connected -> skip immediately
+        if ((connected_mask & (1 << current_player)) == 0) {
+            int fixed = findNextConnected(current_player, connected_mask);
+            if (fixed != -1) {
+                st->shared_int[0] = fixed;
+                st->shared_int[2] = 0;
+                st->turn_start_ns = 0;   // not handed on by a guess
+                new_turn = true;
+            }
+        }
+        // ONLY rotate when current player finished a move
+        else if (turn_done == 1) {
+            int next = findNextConnected(current_player, connected_mask);
+            if (next != -1) st->shared_int[0] = next;
+            st->shared_int[2] = 0; // reset turn_done
+            new_turn = true;
+
+            if (trace_enabled && st->turn_done_ns && st->trace_id) {
+                int64_t now = traceNowNs();
+                traceRecord("turn_done_seen", st->trace_id, st->turn_done_ns, now, 't');
+                st->turn_start_ns = now;
+            }
+        }
+    }
+    current_player = st->shared_int[0];
+
+    pthread_mutex_unlock(&st->shared_mutex);
+
+    // Idle timers follow the connected mask
+    for (int p = 0; p < MAX_PLAYERS; p++) {
+        int bit = 1 << p;
+        if ((connected_mask & bit) && !(r->known_mask & bit)) {
+            if (r->idle_ticks > 0) timerArm(r->wheel, &r->idle_timer[p], r->idle_ticks);
+            r->known_mask |= bit;
+        } else if (!(connected_mask & bit) && (r->known_mask & bit)) {
+            timerCancel(r->wheel, &r->idle_timer[p]);
+            r->known_mask &= ~bit;
+        }
+    }
+
+    // Turn timer follows whoever holds the turn
+    if (connected_mask == 0) {
+        timerCancel(r->wheel, &r->turn_timer);
+        r->turn_timer.data = -1;
+    } else if (r->quantum_ticks > 0 &&
+               (new_turn || r->turn_timer.data != current_player || !timerPending(&r->turn_timer))) {
+        r->turn_timer.data = current_player;
+        timerArm(r->wheel, &r->turn_timer, r->quantum_ticks);
+    }
+    return true;
+}
+
+static void* roundRobinThread(void* arg) {
+    SchedulerArgs* a = (SchedulerArgs*)arg;
+
+    // A single timerfd clocks the wheel for every room
+    TimerWheel* wheel;
+    int tfd = wheelClockOpen(&wheel, 0);
+    if (tfd < 0) return nullptr;
+
+    RoomSched room;
+    roomInit(&room, a->st, wheel, a->quantum_ms, a->idle_ms);
+
+    LOG_INFO("[SCHED] Round Robin scheduler started.");
+
+    while (true) {
+        uint64_t ticks;
+        if (read(tfd, &ticks, sizeof(ticks)) != sizeof(ticks)) continue;  // EINTR
+
+        wheelAdvance(wheel, ticks);
+        if (!roomStep(&room)) break;
+        traceFlush();
+    }
+
+    // Game over (won, or the server is stopping): journal what was played
+    stateLock(a->st);
+    historyRecordGame(a->history, a->st, 0, 0);
+    pthread_mutex_unlock(&a->st->shared_mutex);
+
+    delete wheel;
+    close(tfd);
+    return nullptr;
+}
+
+/* =========================================================
+   ============== Sharded Room Runtime =====================
+   ========================================================= */
+// Rooms are partitioned across worker threads, one pinned per core. A
+// shard is the only thread that touches its rooms: it drains their guess
+// inboxes, judges guesses and runs roomStep() on its own timing wheel, so
+// nothing on the game path is shared between shards. An idle or lightly
+// loaded shard asks the busiest one for a whole room, at most once per
+// tick; the owner hands one over between two passes only if that narrows
+// the gap, so a room is never touched by two shards at once and rooms do
+// not bounce back and forth. A room's load is what it actually did: a
+// moving average of the guesses it accepted per pass.
+
+static const int ROOM_INBOX = 64;   // power of two
+static const int LOAD_SCALE = 256;  // room load is in 1/256 guess per pass
+
+struct GuessMsg {
+    int player;
+    int guess;
+};
+
+struct Room {
+    int id;
+    SharedState state;          // same fields as the shm SharedState, process-local
+    RoomSched   sched;
+    int secret;
+    unsigned seed;
+    int scores[MAX_PLAYERS];
+    const char* last_reply[MAX_PLAYERS];
+    long guesses;
+    int load;                   // EWMA (1/8) of guesses accepted per pass, x LOAD_SCALE
+
+    // Single-producer/single-consumer inbox; the owning shard consumes
+    atomic<unsigned> in_head;
+    atomic<unsigned> in_tail;
+    GuessMsg inbox[ROOM_INBOX];
+
+    // Bot players (bench-shards drives every room this way): guesses per pass
+    int bot_rate;
+    int bot_lo, bot_hi;
+
+    GameHistory* history;       // finished games are journaled here if set
+};
+
+struct Shard {
+    int id;
+    int cpu;
+    pthread_t tid;
+    struct ShardRuntime* rt;
+    vector<Room*> rooms;            // owner thread only
+
+    atomic<int>   load;             // sum of its rooms' loads after the last pass
+    atomic<int>   nrooms;           // rooms.size(), for readers on other threads
+    atomic<long>  guesses;          // guesses processed so far
+    atomic<long>  steals;           // rooms this shard has taken
+    atomic<int>   steal_request;    // id of a shard asking us for a room, or -1
+    atomic<int>   steal_pending;    // 1 from our request until it is answered and any room adopted
+    atomic<Room*> handoff;          // room given to us by a victim
+};
+
+struct ShardRuntime {
+    int nshards;
+    Shard* shards;
+    int quantum_ms;
+    int idle_ms;
+    GameHistory* history;           // optional, shared by all rooms
+    atomic<bool> stop;
+};
+
+static void roomNewSecret(Room* r) {
+    r->secret = (rand_r(&r->seed) % 100) + 1;
+    r->bot_lo = 1;
+    r->bot_hi = 100;
+    r->state.winner = -1;
+    r->state.moves.start_ms = wallMs();
+    r->state.moves.count = 0;
+}
+
+static Room* roomCreate(int id, int bot_rate) {
+    Room* r = new Room;
+    r->id = id;
+    memset(&r->state, 0, sizeof(r->state));
+    pthread_mutex_init(&r->state.shared_mutex, nullptr);
+    r->seed = (unsigned)(time(nullptr) ^ (id * 2654435761u));
+    memset(r->scores, 0, sizeof(r->scores));
+    for (int p = 0; p < MAX_PLAYERS; p++) r->last_reply[p] = nullptr;
+    r->guesses = 0;
+    r->load = 0;
+    r->in_head.store(0);
+    r->in_tail.store(0);
+    r->bot_rate = bot_rate;
+    r->history = nullptr;
+    roomNewSecret(r);
+    return r;
+}
+
+static void roomDestroy(Room* r) {
+    pthread_mutex_destroy(&r->state.shared_mutex);
+    delete r;
+}
+
+// Queue a guess for the room (producer side). False if the inbox is full.
+static bool roomSubmit(Room* r, int player, int guess) {
+    unsigned head = r->in_head.load(memory_order_relaxed);
+    if (head - r->in_tail.load(memory_order_acquire) == (unsigned)ROOM_INBOX) return false;
+    r->inbox[head & (ROOM_INBOX - 1)] = GuessMsg{player, guess};
+    r->in_head.store(head + 1, memory_order_release);
+    return true;
+}
+
+// Judge one guess against the room. Returns true if it was accepted.
+static bool roomGuess(Room* r, int player, int guess) {
+    SharedState* st = &r->state;
+
+    stateLock(st);
+    st->last_active_ms[player] = monoMs();
+    st->shared_int[1] |= (1 << player);
+    bool my_turn = st->shared_int[0] == player && st->shared_int[2] == 0;
+    if (my_turn) st->shared_int[2] = 1;   // current player finished move
+    pthread_mutex_unlock(&st->shared_mutex);
+
+    if (!my_turn) {
+        r->last_reply[player] = "REJECT Not your turn!";
+        return false;
+    }
+
+    const char* reply = judgeGuess(r->secret, guess);
+    r->last_reply[player] = reply;
+    r->guesses++;
+
+    // Only this shard touches the room's moves, no lock needed
+    GameMoves* mv = &st->moves;
+    if (r->history && mv->count < MAX_MOVES) {
+        GameMove m = {(uint8_t)player, moveGuess(guess), 0, (uint32_t)(wallMs() - mv->start_ms)};
+        mv->list[mv->count++] = m;
+    }
+
+    if (guess == r->secret) {
+        r->scores[player]++;
+        LOG_DEBUG("[ROOM] Room {}: player {} guessed {} and WON!", r->id, player, guess);
+        st->winner = player;
+        historyRecordGame(r->history, st, r->id, histRoomFirstPlayer(r->id));
+        roomNewSecret(r);           // rooms roll straight into the next game
+    } else if (guess < r->secret) {
+        r->bot_lo = guess + 1;
+    } else {
+        r->bot_hi = guess - 1;
+    }
+
+    roomStep(&r->sched);            // pass the turn on right away
+    return true;
+}
+
+// Bots play in turn order from whoever holds the turn, bisecting
+// towards the secret
+static void roomBotPass(Room* r) {
+    stateLock(&r->state);
+    int current = r->state.shared_int[0];
+    pthread_mutex_unlock(&r->state.shared_mutex);
+
+    for (int i = 0; i < r->bot_rate; i++) {
+        roomSubmit(r, (current + i) % MAX_PLAYERS, (r->bot_lo + r->bot_hi) / 2);
+    }
+}
+
+// Drain the room's inbox. Returns the number of guesses accepted.
+static int roomDrain(Room* r) {
+    int accepted = 0;
+    unsigned tail = r->in_tail.load(memory_order_relaxed);
+    unsigned head = r->in_head.load(memory_order_acquire);
+
+    while (tail != head) {
+        GuessMsg m = r->inbox[tail & (ROOM_INBOX - 1)];
+        tail++;
+        if (m.player >= 0 && m.player < MAX_PLAYERS && roomGuess(r, m.player, m.guess)) accepted++;
+    }
+    r->in_tail.store(tail, memory_order_release);
+    return accepted;
+}
+
+// Fold one pass into the room's load
+static int roomLoad(Room* r, int accepted) {
+    r->load += (accepted * LOAD_SCALE - r->load) / 8;
+    return r->load;
+}
+
+// A room arriving on a shard: its timers live on that shard's wheel
+static void shardAdopt(Shard* sh, TimerWheel* wheel, Room* r) {
+    roomInit(&r->sched, &r->state, wheel, sh->rt->quantum_ms, sh->rt->idle_ms);
+    r->history = sh->rt->history;
+    sh->rooms.push_back(r);
+    sh->nrooms.store((int)sh->rooms.size(), memory_order_relaxed);
+}
+
+// Answer a thief between passes: give it the room that best evens out
+// the load, or nothing if moving any room would not help.
+static void shardServeSteal(Shard* sh, int my_load) {
+    int thief_id = sh->steal_request.load(memory_order_acquire);
+    if (thief_id < 0) return;
+
+    Shard* thief = &sh->rt->shards[thief_id];
+    int gap = my_load - thief->load.load(memory_order_relaxed);
+
+    int best = -1, best_load = 0;
+    if (sh->rooms.size() > 1) {
+        for (size_t i = 0; i < sh->rooms.size(); i++) {
+            int l = sh->rooms[i]->load;
+            if (2 * l <= gap && l > best_load) {
+                best = (int)i;
+                best_load = l;
+            }
+        }
+    }
+
+    if (best >= 0) {
+        Room* r = sh->rooms[best];
+        sh->rooms[best] = sh->rooms.back();
+        sh->rooms.pop_back();
+        sh->nrooms.store((int)sh->rooms.size(), memory_order_relaxed);
+        roomCancelTimers(&r->sched);
+        // The slot is free: the thief keeps steal_pending set, and so posts
+        // no other request, until it has taken the room out and adopted it
+        thief->handoff.store(r, memory_order_release);
+    } else {
+        thief->steal_pending.store(0, memory_order_release);
+    }
+    sh->steal_request.store(-1, memory_order_release);
+}
+
+// Ask the busiest other shard for a room if it has more work than us
+static void shardTrySteal(Shard* sh, int my_load) {
+    if (sh->steal_pending.load(memory_order_acquire)) return;
+
+    ShardRuntime* rt = sh->rt;
+    Shard* victim = nullptr;
+    int victim_load = my_load;
+    for (int i = 0; i < rt->nshards; i++) {
+        Shard* s = &rt->shards[i];
+        int l = s->load.load(memory_order_relaxed);
+        if (s != sh && l > victim_load) {
+            victim = s;
+            victim_load = l;
+        }
+    }
+    if (!victim) return;
+
+    int expected = -1;
+    sh->steal_pending.store(1, memory_order_relaxed);
+    if (!victim->steal_request.compare_exchange_strong(expected, sh->id, memory_order_acq_rel)) {
+        sh->steal_pending.store(0, memory_order_relaxed);
+    }
+}
+
+static void pinToCpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static void* shardThread(void* arg) {
+    Shard* sh = (Shard*)arg;
+    ShardRuntime* rt = sh->rt;
+    pinToCpu(sh->cpu);
+
+    TimerWheel* wheel;
+    int tfd = wheelClockOpen(&wheel, TFD_NONBLOCK);
+    if (tfd < 0) return nullptr;
+
+    // Rooms placed before start still need their timers on this wheel
+    vector<Room*> initial;
+    initial.swap(sh->rooms);
+    for (size_t i = 0; i < initial.size(); i++) shardAdopt(sh, wheel, initial[i]);
+
+    long guesses = 0;
+    while (!rt->stop.load(memory_order_relaxed)) {
+        Room* got = sh->handoff.exchange(nullptr, memory_order_acquire);
+        if (got) {
+            shardAdopt(sh, wheel, got);
+            sh->steals.fetch_add(1, memory_order_relaxed);
+            sh->steal_pending.store(0, memory_order_release);
+        }
+
+        uint64_t ticks = 0;
+        if (read(tfd, &ticks, sizeof(ticks)) == sizeof(ticks)) wheelAdvance(wheel, ticks);
+
+        int load = 0, worked = 0;
+        for (size_t i = 0; i < sh->rooms.size(); i++) {
+            Room* r = sh->rooms[i];
+            if (r->bot_rate > 0) roomBotPass(r);
+            int accepted = roomDrain(r);
+            worked += accepted;
+            roomStep(&r->sched);
+            load += roomLoad(r, accepted);
+        }
+        guesses += worked;
+        sh->load.store(load, memory_order_relaxed);
+        sh->guesses.store(guesses, memory_order_relaxed);
+
+        shardServeSteal(sh, load);
+
+        // Look for work at most once per tick; sleep until the next one if idle
+        if (worked == 0 || ticks > 0) shardTrySteal(sh, load);
+        if (worked == 0) {
+            pollfd pfd = {tfd, POLLIN, 0};
+            poll(&pfd, 1, SCHED_TICK_MS);
+        }
+    }
+
+    for (size_t i = 0; i < sh->rooms.size(); i++) roomCancelTimers(&sh->rooms[i]->sched);
+    delete wheel;
+    close(tfd);
+    return nullptr;
+}
+
+// The CPUs this process may run on; shards go round-robin over them
+static vector<int> allowedCpus() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    vector<int> cpus;
+    for (int c = 0; c < CPU_SETSIZE; c++)
+        if (CPU_ISSET(c, &allowed)) cpus.push_back(c);
+    if (cpus.empty()) cpus.push_back(0);
+    return cpus;
+}
+
+static void runtimeInit(ShardRuntime* rt, int nshards, int quantum_ms, int idle_ms) {
+    vector<int> cpus = allowedCpus();
+
+    rt->nshards = nshards;
+    rt->shards = new Shard[nshards];
+    rt->quantum_ms = quantum_ms;
+    rt->idle_ms = idle_ms;
+    rt->history = nullptr;
+    rt->stop.store(false);
+
+    for (int i = 0; i < nshards; i++) {
+        Shard* sh = &rt->shards[i];
+        sh->id = i;
+        sh->cpu = cpus[i % cpus.size()];
+        sh->rt = rt;
+        sh->load.store(0);
+        sh->nrooms.store(0);
+        sh->guesses.store(0);
+        sh->steals.store(0);
+        sh->steal_request.store(-1);
+        sh->steal_pending.store(0);
+        sh->handoff.store(nullptr);
+    }
+}
+
+// Only valid before runtimeStart(); afterwards rooms move by stealing
+static void runtimeAddRoom(ShardRuntime* rt, Room* r, int shard) {
+    rt->shards[shard % rt->nshards].rooms.push_back(r);
+}
+
+static void runtimeStart(ShardRuntime* rt) {
+    for (int i = 0; i < rt->nshards; i++)
+        pthread_create(&rt->shards[i].tid, nullptr, shardThread, &rt->shards[i]);
+    LOG_INFO("[SHARD] {} shards started.", rt->nshards);
+}
+
+static long runtimeGuesses(ShardRuntime* rt) {
+    long total = 0;
+    for (int i = 0; i < rt->nshards; i++)
+        total += rt->shards[i].guesses.load(memory_order_relaxed);
+    return total;
+}
+
+// Stop every shard and destroy all rooms
+static void runtimeStop(ShardRuntime* rt) {
+    rt->stop.store(true);
+    for (int i = 0; i < rt->nshards; i++) pthread_join(rt->shards[i].tid, nullptr);
+
+    for (int i = 0; i < rt->nshards; i++) {
+        Shard* sh = &rt->shards[i];
+        Room* r = sh->handoff.exchange(nullptr);
+        if (r) sh->rooms.push_back(r);
+        for (size_t k = 0; k < sh->rooms.size(); k++) roomDestroy(sh->rooms[k]);
+        sh->rooms.clear();
+    }
+    delete[] rt->shards;
+    rt->shards = nullptr;
+    LOG_INFO("[SHARD] Shards stopped.");
+}
+
+// ---------------------------
+// Logger Thread
+// ---------------------------
+static void* loggerThread(void*) {
+    int fd = open(log_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+    if (fd < 0) return nullptr;
+
+    LOG_INFO("[LOG] Logger started.");
+
+    // Records are copied out in batches and each batch goes to the file
+    // in one O_APPEND write(), so lines from the several processes that
+    // share game.log never interleave.
+    static const int BATCH = 64;
+    static const int LINE_MAX = 512;
+    static LogRecord batch[BATCH];
+    static char out[BATCH * LINE_MAX + LINE_MAX];
+    unsigned reported_drops = 0;
+
+    while (true) {
+        pthread_mutex_lock(&log_mutex);
+        while (log_head == log_tail && logger_running) {
+            pthread_cond_wait(&log_cv, &log_mutex);
+        }
+
+        if (!logger_running && log_head == log_tail) {
+            pthread_mutex_unlock(&log_mutex);
+            break;
+        }
+
+        int n = 0;
+        while (n < BATCH && log_tail != log_head) {
+            const LogRecord& slot = log_ring[log_tail % LOG_RING_SIZE];
+            memcpy(&batch[n++], &slot, offsetof(LogRecord, args) + slot.used);
+            log_tail++;
+        }
+        unsigned dropped = log_dropped;
+        pthread_mutex_unlock(&log_mutex);
+
+        size_t used = 0;
+        for (int i = 0; i < n; i++) {
+            used += logFormat(batch[i], out + used, LINE_MAX);
+            out[used++] = '\n';
+        }
+        if (dropped != reported_drops) {
+            used += snprintf(out + used, LINE_MAX, "%s [LOG] %u messages dropped (ring full)\n",
+                             nowString().c_str(), dropped - reported_drops);
+            reported_drops = dropped;
+        }
+        if (used) write(fd, out, used);
+    }
+
+    string last = nowString() + " [LOG] Logger stopped.\n";
+    write(fd, last.data(), last.size());
+    close(fd);
+    return nullptr;
+}
+
+// fork() may happen while other threads log: hold the ring lock across
+// it so the child never inherits it locked. The child gets a fresh lock
+// and an empty ring (the parent's pending records are the parent's to
+// write) and starts its own logger thread if it wants one.
+static void logBeforeFork() {
+    pthread_mutex_lock(&log_mutex);
+}
+
+static void logAfterForkParent() {
+    pthread_mutex_unlock(&log_mutex);
+}
+
+static void logAfterForkChild() {
+    pthread_mutex_init(&log_mutex, nullptr);
+    pthread_cond_init(&log_cv, nullptr);
+    log_head = log_tail = 0;
+    log_dropped = 0;
+}
+
+// Must run before the first LOG_* call of a process that forks: records
+// queued before a fork would otherwise be written again by every child.
+static void logInitFork() {
+    static bool fork_handlers = false;
+    if (!fork_handlers) {
+        pthread_atfork(logBeforeFork, logAfterForkParent, logAfterForkChild);
+        fork_handlers = true;
+    }
+}
+
+static void startLogger() {
+    logInitFork();
+
+    pthread_mutex_lock(&log_mutex);
+    logger_running = true;
+    pthread_mutex_unlock(&log_mutex);
+    pthread_create(&logger_tid, nullptr, loggerThread, nullptr);
+}
+
+static void stopLogger() {
+    pthread_mutex_lock(&log_mutex);
+    logger_running = false;
+    pthread_cond_signal(&log_cv);
+    pthread_mutex_unlock(&log_mutex);
+
+    pthread_join(logger_tid, nullptr);
+}
+
+// ---------------------------
+// Process-shared mutex init
+// ---------------------------
+static void initProcessSharedMutex(pthread_mutex_t* mtx) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(mtx, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+// ---------------------------
+// Shared memory setup
+// ---------------------------
+static SharedState* createOrOpenSharedMemory(bool create_new) {
+    int fd;
+    if (create_new) {
+        shm_unlink(SHM_NAME);
+        fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
+    } else {
+        fd = shm_open(SHM_NAME, O_RDWR, 0666);
+    }
+
+    if (fd < 0) return nullptr;
+
+    if (create_new) {
+        ftruncate(fd, sizeof(SharedState));
+    }
+
+    void* mem = mmap(nullptr, sizeof(SharedState),
+                     PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    return (SharedState*)mem;
+}
+
+/* =========================================================
+   ============ Multi-process Room Table ===================
+   ========================================================= */
+// "./server multi [rooms]" runs one of several cooperating server
+// processes on a host. They all attach to one shared room table (never
+// unlinked, so no process can wipe another's state) and each claims up to
+// `rooms` rooms by CAS on a word holding the owner pid and its lease
+// deadline, so ownership and lease always change together. An owner
+// renews every ROOM_RENEW_MS; a room whose owner pid is gone, or whose
+// lease ran out, can be taken over by anyone, mid-game. An owner that
+// stalled past its lease finds another pid in the word on its next
+// renewal and lets the room go. Every claim bumps the room's epoch (for
+// logs). More processes = more rooms served; nothing coordinates them
+// but the table itself.
+//
+// Within a process the rooms are sharded like the runtime above: one
+// scheduler thread per CPU the process may use (or "./server multi rooms
+// shards"), each pinned, with its own wheel, and each claiming only the
+// rooms whose index falls in its share (idx % shards), so two shards of
+// one pid never contend for a lease. Rooms do not move between shards;
+// the guesses themselves are judged in the forked handlers.
+//
+// The table outlives every binary that used it, so its header records
+// the layout version and size. Creating, checking and rebuilding it all
+// happen under an exclusive flock on a lock file next to it that is never
+// removed; the kernel drops the lock if its holder dies. Under that lock a
+// table that is empty or has no magic was abandoned mid-build, and it is
+// rebuilt in place, as is one from another build, unless some process
+// still maps it: then it is refused.
+
+static const char* ROOM_TABLE_SHM = "/guess_game_rooms";
+static const char* ROOM_TABLE_LOCK = "/dev/shm/guess_game_rooms.lock";
+static const uint32_t ROOM_TABLE_MAGIC   = 0x32544d52;  // "RMT2"
+static const uint32_t ROOM_TABLE_VERSION = 1;
+static const int  MAX_ROOMS      = 64;
+static const int  MAX_SERVERS    = 32;
+static const long ROOM_LEASE_MS  = 3000;
+static const long ROOM_RENEW_MS  = 500;
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+              "room table atomics must be lock-free to live in shared memory");
+
+struct RoomSlot {
+    atomic<uint64_t> lease;         // owner pid << 32 | deadline (CLOCK_MONOTONIC ms, low 32 bits); 0 = free
+    atomic<uint32_t> epoch;         // bumped by every claim
+    int secret;
+    SharedState state;              // same layout the single-room server uses
+};
+
+struct RoomTable {
+    atomic<uint32_t> magic;         // set last, once every room is initialised
+    uint32_t version;               // ROOM_TABLE_VERSION of the creator
+    uint64_t size;                  // sizeof(RoomTable) of the creator
+    atomic<int32_t>  servers[MAX_SERVERS];  // pid per server slot (journal dir)
+    RoomSlot rooms[MAX_ROOMS];
+};
+
+static bool pidAlive(pid_t pid) {
+    return pid > 0 && (kill(pid, 0) == 0 || errno != ESRCH);
+}
+
+// Does any process but this one have the shm object `name` mapped?
+static bool shmMappedElsewhere(const char* name) {
+    string needle = string("/dev/shm") + name;
+    bool found = false;
+    DIR* d = opendir("/proc");
+    if (!d) return true;    // cannot tell: assume it is
+    while (dirent* e = readdir(d)) {
+        int pid = atoi(e->d_name);
+        if (pid <= 0 || pid == getpid()) continue;
+        ifstream maps((string("/proc/") + e->d_name + "/maps").c_str());
+        string line;
+        while (!found && getline(maps, line)) {
+            size_t at = line.find(needle);
+            found = at != string::npos && line.compare(at, string::npos, needle) == 0;
+        }
+        if (found) break;
+    }
+    closedir(d);
+    return found;
+}
+
+// Header of a table of our own layout, complete; else why it is not
+static const char* roomTableCheck(int fd) {
+    struct stat sb;
+    if (fstat(fd, &sb) != 0) return "cannot stat";
+    if (sb.st_size != (off_t)sizeof(RoomTable)) return "size differs from this build";
+
+    char head[offsetof(RoomTable, servers)];
+    if (pread(fd, head, sizeof(head), 0) != (ssize_t)sizeof(head)) return "cannot read header";
+    uint32_t magic, version;
+    uint64_t size;
+    memcpy(&magic, head + offsetof(RoomTable, magic), sizeof(magic));
+    memcpy(&version, head + offsetof(RoomTable, version), sizeof(version));
+    memcpy(&size, head + offsetof(RoomTable, size), sizeof(size));
+    if (magic != ROOM_TABLE_MAGIC) return "never finished (no magic)";
+    if (version != ROOM_TABLE_VERSION || size != sizeof(RoomTable)) return "layout differs from this build";
+    return nullptr;
+}
+
+static void roomTableBuild(RoomTable* t) {
+    for (int i = 0; i < MAX_SERVERS; i++) t->servers[i].store(0);
+    for (int i = 0; i < MAX_ROOMS; i++) {
+        RoomSlot* s = &t->rooms[i];
+        s->lease.store(0);
+        s->epoch.store(0);
+        initProcessSharedMutex(&s->state.shared_mutex);
+        s->state.shared_int[3] = 1;     // no game yet
+        s->state.winner = -1;
+    }
+    t->version = ROOM_TABLE_VERSION;
+    t->size = sizeof(RoomTable);
+    t->magic.store(ROOM_TABLE_MAGIC, memory_order_release);
+}
+
+// Attach to the host's room table, creating it if this is the first server
+static RoomTable* attachRoomTable() {
+    int lfd = open(ROOM_TABLE_LOCK, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (lfd < 0) return nullptr;
+    flock(lfd, LOCK_EX);
+
+    void* mem = MAP_FAILED;
+    int fd = shm_open(ROOM_TABLE_SHM, O_CREAT | O_RDWR | O_CLOEXEC, 0666);
+    if (fd >= 0) {
+        struct stat sb;
+        const char* bad = roomTableCheck(fd);
+        bool fresh = fstat(fd, &sb) == 0 && sb.st_size == 0;
+
+        if (bad && !fresh && shmMappedElsewhere(ROOM_TABLE_SHM)) {
+            LOG_ERROR("[MULTI] Room table {}: {}, and still in use; stop the servers using it", ROOM_TABLE_SHM, bad);
+            fprintf(stderr, "Room table %s: %s, and still in use by other processes\n", ROOM_TABLE_SHM, bad);
+        } else if (bad) {
+            if (!fresh) LOG_WARN("[MULTI] Room table {}: {}, rebuilding", ROOM_TABLE_SHM, bad);
+            // Truncating to 0 first zeroes whatever was there
+            if (ftruncate(fd, 0) == 0 && ftruncate(fd, sizeof(RoomTable)) == 0)
+                mem = mmap(nullptr, sizeof(RoomTable), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (mem != MAP_FAILED) {
+                roomTableBuild((RoomTable*)mem);
+                LOG_INFO("[MULTI] Created room table {} ({} rooms)", ROOM_TABLE_SHM, MAX_ROOMS);
+            }
+        } else {
+            mem = mmap(nullptr, sizeof(RoomTable), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+    }
+
+    close(lfd);                     // drops the lock
+    return mem == MAP_FAILED ? nullptr : (RoomTable*)mem;
+}
+
+// A server slot gives this process a stable journal directory
+static int claimServerSlot(RoomTable* t) {
+    pid_t me = getpid();
+    for (int i = 0; i < MAX_SERVERS; i++) {
+        int32_t pid = t->servers[i].load();
+        if ((pid == 0 || !pidAlive(pid)) && t->servers[i].compare_exchange_strong(pid, me)) return i;
+    }
+    return -1;
+}
+
+static uint64_t leaseWord(pid_t owner, int64_t deadline_ms) {
+    return ((uint64_t)(uint32_t)owner << 32) | (uint32_t)deadline_ms;
+}
+
+// Try to take a room: free, owner dead, or lease expired. Returns the new
+// epoch, or 0 if someone else holds it.
+static uint32_t claimRoom(RoomSlot* s, int64_t now) {
+    uint64_t cur = s->lease.load(memory_order_acquire);
+    pid_t owner = (pid_t)(cur >> 32);
+    int32_t left = (int32_t)((uint32_t)cur - (uint32_t)now);    // wrap-safe
+    if (owner != 0 && left > 0 && pidAlive(owner)) return 0;
+
+    if (!s->lease.compare_exchange_strong(cur, leaseWord(getpid(), now + ROOM_LEASE_MS),
+                                          memory_order_acq_rel)) return 0;
+    return s->epoch.fetch_add(1) + 1;
+}
+
+// Extend our lease. False if the room was taken over meanwhile.
+static bool renewRoom(RoomSlot* s, int64_t now) {
+    uint64_t cur = s->lease.load(memory_order_acquire);
+    if ((pid_t)(cur >> 32) != getpid()) return false;
+    return s->lease.compare_exchange_strong(cur, leaseWord(getpid(), now + ROOM_LEASE_MS),
+                                            memory_order_acq_rel);
+}
+
+static void releaseRoom(RoomSlot* s) {
+    uint64_t cur = s->lease.load(memory_order_acquire);
+    if ((pid_t)(cur >> 32) == getpid()) s->lease.compare_exchange_strong(cur, 0);
+}
+
+// A room this process serves
+struct OwnedRoom {
+    int       idx;
+    RoomSlot* slot;
+    uint32_t  epoch;
+    RoomSched sched;
+    pid_t     children[MAX_PLAYERS];
+    bool      restarting;           // game ended, waiting for handlers to exit
+};
+
+// One scheduler shard of a multi server
+struct MultiArgs {
+    RoomTable*   table;
+    int          shard;         // claims rooms with idx % nshards == shard
+    int          nshards;
+    int          cpu;
+    int          want_rooms;    // this shard's share
+    int          quantum_ms;
+    int          idle_ms;
+    GameHistory* history;
+    atomic<bool> stop;
+};
+
+static void roomStartGame(OwnedRoom* o) {
+    SharedState* st = &o->slot->state;
+    unsigned seed = (unsigned)(wallMs() ^ (getpid() << 8) ^ o->idx);
+
+    stateLock(st);
+    st->shared_int[0] = 0;
+    st->shared_int[1] = 0;
+    st->shared_int[2] = 0;
+    st->shared_int[3] = 0;
+    st->winner = -1;
+    st->moves.count = 0;
+    st->moves.start_ms = wallMs();
+    st->trace_id = 0;
+    st->turn_done_ns = 0;
+    st->turn_start_ns = 0;
+    o->slot->secret = (rand_r(&seed) % 100) + 1;
+    pthread_mutex_unlock(&st->shared_mutex);
+
+    LOG_INFO("[MULTI] Room {}: new game", o->idx);
+}
+
+// Fork one handler per seat. They die with this thread (PDEATHSIG), so a
+// crashed owner leaves no handler behind to fight the next owner's.
+static void roomSpawnHandlers(OwnedRoom* o) {
+    pid_t parent = getpid();
+    for (int seat = 0; seat < MAX_PLAYERS; seat++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+            if (getppid() != parent) _exit(0);
+            signal(SIGINT, SIG_IGN);        // the owner decides when we stop
+
+            secret_number = o->slot->secret;
+            trace_process = "handler";
+            startLogger();
+            handleClient(&o->slot->state, o->idx, seat);
+            stopLogger();
+            _exit(0);
+        }
+        o->children[seat] = pid;
+    }
+}
+
+// True once every handler of the room has exited
+static bool roomReapHandlers(OwnedRoom* o, bool block) {
+    bool all = true;
+    for (int seat = 0; seat < MAX_PLAYERS; seat++) {
+        if (o->children[seat] <= 0) continue;
+        if (waitpid(o->children[seat], nullptr, block ? 0 : WNOHANG) == 0) all = false;
+        else o->children[seat] = 0;
+    }
+    return all;
+}
+
+// SIGTERM skips handleClient's own cleanup, so the FIFOs are removed here;
+// a client left waiting then sees no FIFO instead of blocking in open().
+static void roomStopHandlers(OwnedRoom* o) {
+    for (int seat = 0; seat < MAX_PLAYERS; seat++)
+        if (o->children[seat] > 0) kill(o->children[seat], SIGTERM);
+    roomReapHandlers(o, true);
+    char fifo_name[100];
+    for (int seat = 0; seat < MAX_PLAYERS; seat++) {
+        snprintf(fifo_name, sizeof(fifo_name), "/tmp/guess_game_client_%d_%d", o->idx, seat);
+        unlink(fifo_name);
+    }
+}
+
+static OwnedRoom* adoptRoom(MultiArgs* a, TimerWheel* wheel, int idx, uint32_t epoch) {
+    OwnedRoom* o = new OwnedRoom;
+    o->idx = idx;
+    o->slot = &a->table->rooms[idx];
+    o->epoch = epoch;
+    o->restarting = false;
+    for (int seat = 0; seat < MAX_PLAYERS; seat++) o->children[seat] = 0;
+
+    SharedState* st = &o->slot->state;
+    stateLock(st);
+    bool running = st->shared_int[3] == 0;
+    st->shared_int[1] = 0;      // players rejoin on their next message
+    pthread_mutex_unlock(&st->shared_mutex);
+
+    if (running) LOG_INFO("[MULTI] Room {}: taken over mid-game (epoch {})", idx, epoch);
+    else roomStartGame(o);
+
+    roomInit(&o->sched, st, wheel, a->quantum_ms, a->idle_ms);
+    roomSpawnHandlers(o);
+    return o;
+}
+
+static void* multiRoomThread(void* arg) {
+    MultiArgs* a = (MultiArgs*)arg;
+    if (a->nshards > 1) pinToCpu(a->cpu);
+
+    TimerWheel* wheel;
+    int tfd = wheelClockOpen(&wheel, 0);
+    if (tfd < 0) {
+        g_stop = 1;         // a server that cannot schedule should not hold a slot
+        return nullptr;
+    }
+    vector<OwnedRoom*> owned;
+    int64_t next_lease_check = 0;
+
+    while (!a->stop.load()) {
+        uint64_t ticks;
+        if (read(tfd, &ticks, sizeof(ticks)) != sizeof(ticks)) continue;  // EINTR
+        wheelAdvance(wheel, ticks);
+
+        for (size_t i = 0; i < owned.size(); i++) {
+            OwnedRoom* o = owned[i];
+            if (o->restarting) {
+                if (!roomReapHandlers(o, false)) continue;
+                o->restarting = false;
+                roomStartGame(o);
+                roomInit(&o->sched, &o->slot->state, wheel, a->quantum_ms, a->idle_ms);
+                roomSpawnHandlers(o);
+            } else if (!roomStep(&o->sched)) {
+                // Handlers leave on game over; start again once they are gone
+                stateLock(&o->slot->state);
+                historyRecordGame(a->history, &o->slot->state, o->idx, histRoomFirstPlayer(o->idx));
+                pthread_mutex_unlock(&o->slot->state.shared_mutex);
+                o->restarting = true;
+            }
+        }
+        traceFlush();
+
+        int64_t now = monoMs();
+        if (now < next_lease_check) continue;
+        next_lease_check = now + ROOM_RENEW_MS;
+
+        // Renew what we hold; drop what was taken from us
+        for (size_t i = 0; i < owned.size(); ) {
+            OwnedRoom* o = owned[i];
+            if (renewRoom(o->slot, now)) {
+                i++;
+                continue;
+            }
+            LOG_WARN("[MULTI] Room {}: lease lost, letting it go", o->idx);
+            roomCancelTimers(&o->sched);
+            roomStopHandlers(o);
+            delete o;
+            owned[i] = owned.back();
+            owned.pop_back();
+        }
+
+        // Claim more: orphaned rooms first (their players are waiting), then
+        // free ones, starting at a per-process offset so servers spread out
+        int start = getpid() % MAX_ROOMS;
+        for (int pass = 0; pass < 2; pass++) {
+            for (int k = 0; k < MAX_ROOMS && (int)owned.size() < a->want_rooms; k++) {
+                int idx = (start + k) % MAX_ROOMS;
+                if (idx % a->nshards != a->shard) continue;
+                RoomSlot* s = &a->table->rooms[idx];
+                if (pass == 0 && s->lease.load(memory_order_relaxed) == 0) continue;
+
+                bool mine = false;
+                for (size_t i = 0; i < owned.size() && !mine; i++) mine = owned[i]->idx == idx;
+                if (mine) continue;
+
+                uint32_t epoch = claimRoom(s, now);
+                if (epoch == 0) continue;
+                owned.push_back(adoptRoom(a, wheel, idx, epoch));
+                LOG_INFO("[MULTI] Shard {}: claimed room {} (epoch {}), serving {}",
+                         a->shard, idx, epoch, owned.size());
+            }
+        }
+    }
+
+    // Leave the games running in the table: stop our handlers and free the
+    // rooms so another server picks them up right away
+    for (size_t i = 0; i < owned.size(); i++) {
+        OwnedRoom* o = owned[i];
+        roomCancelTimers(&o->sched);
+        roomStopHandlers(o);
+        releaseRoom(o->slot);
+        LOG_INFO("[MULTI] Released room {}", o->idx);
+        delete o;
+    }
+
+    delete wheel;
+    close(tfd);
+    return nullptr;
+}
+
+static int runMulti(int want_rooms, int nshards) {
+    startLogger();
+
+    RoomTable* table = attachRoomTable();
+    if (!table) {
+        LOG_ERROR("[MULTI] Cannot attach room table {}", ROOM_TABLE_SHM);
+        stopLogger();
+        return 1;
+    }
+
+    int server = claimServerSlot(table);
+    GameHistory history;
+    bool have_history = false;
+    if (server >= 0) {
+        char dir[64];
+        mkdir(HISTORY_DIR, 0777);
+        snprintf(dir, sizeof(dir), "%s/s%02d", HISTORY_DIR, server);
+        have_history = historyOpen(&history, dir);
+    }
+
+    // One pinned scheduler shard per usable CPU, never more than rooms
+    vector<int> cpus = allowedCpus();
+    if (nshards <= 0) nshards = (int)cpus.size();
+    nshards = max(1, min(nshards, min(want_rooms, MAX_ROOMS)));
+
+    printf("Server %d (PID %d) serving up to %d rooms of %s on %d shards\n",
+           server, getpid(), want_rooms, ROOM_TABLE_SHM, nshards);
+    LOG_INFO("[MULTI] Server slot {} (PID {}), up to {} rooms, {} shards",
+             server, getpid(), want_rooms, nshards);
+
+    MultiArgs* args = new MultiArgs[nshards];
+    pthread_t* tids = new pthread_t[nshards];
+    for (int i = 0; i < nshards; i++) {
+        MultiArgs* a = &args[i];
+        a->table = table;
+        a->shard = i;
+        a->nshards = nshards;
+        a->cpu = cpus[i % cpus.size()];
+        a->want_rooms = want_rooms / nshards + (i < want_rooms % nshards ? 1 : 0);
+        a->quantum_ms = 10000;
+        a->idle_ms = 60000;
+        a->history = have_history ? &history : nullptr;
+        a->stop.store(false);
+        pthread_create(&tids[i], nullptr, multiRoomThread, a);
+    }
+
+    while (!g_stop) {
+        usleep(100 * 1000);
+    }
+
+    printf("Server shutting down...\n");
+    for (int i = 0; i < nshards; i++) args[i].stop.store(true);
+    for (int i = 0; i < nshards; i++) pthread_join(tids[i], nullptr);
+    delete[] tids;
+    delete[] args;
+
+    if (have_history) historyClose(&history);
+    if (server >= 0) {
+        int32_t me = getpid();
+        table->servers[server].compare_exchange_strong(me, 0);
+    }
+    munmap(table, sizeof(RoomTable));   // the table outlives us on purpose
+    traceFlush();
+    stopLogger();
+    return 0;
+}
+
+// ---------------------------
+// Benchmarks
+// ---------------------------
+static double nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Per-turn logging cost in the handleClient loop: one poll line, one
+// "sent:" line and one guess line. "legacy" is what the loop did before
+// (cout + endl, string concatenation, queue<string> push); "deferred" is
+// LOG_DEBUG/LOG_INFO at the configured LOG_LEVEL.
+static int benchLog(int turns) {
+    const int player_id = 2, current = 2, guess = 57;
+    const char* buffer = "GUESS 2 57";
+
+    ofstream devnull("/dev/null");
+    pthread_mutex_t q_mutex = PTHREAD_MUTEX_INITIALIZER;
+    string sink;
+
+    double t0 = nowNs();
+    for (int i = 0; i < turns; i++) {
+        devnull << "DEBUG Player " << player_id << ": My turn? current=" << current
+                << ", me=" << player_id << endl;
+        devnull << "DEBUG: Player " << player_id << " sent: " << buffer << endl;
+
+        string msg = nowString() + " " + "[GAME] Player " + to_string(player_id) +
+                     " guess number " + to_string(guess);
+        pthread_mutex_lock(&q_mutex);
+        sink.swap(msg);
+        pthread_mutex_unlock(&q_mutex);
+    }
+    double legacy = (nowNs() - t0) / turns;
+
+    // Only the enqueue is timed: turns are logged in bursts that fit the
+    // ring with no logger thread running (on one CPU it would format in
+    // the middle of a burst), and the ring is emptied between bursts.
+    // Formatting and writing happen on the logger thread, off the game path.
+    const int BURST = LOG_RING_SIZE / 4;
+    double spent = 0;
+    for (int done = 0; done < turns; done += BURST) {
+        int n = min(BURST, turns - done);
+        t0 = nowNs();
+        for (int i = 0; i < n; i++) {
+            LOG_DEBUG("[CLIENT] Player {}: my turn? current={}", player_id, current);
+            LOG_DEBUG("[CLIENT] Player {} sent: {}", player_id, buffer);
+            LOG_INFO("[GAME] Player {} guess number {}", player_id, guess);
+        }
+        spent += nowNs() - t0;
+
+        pthread_mutex_lock(&log_mutex);
+        log_tail = log_head;
+        pthread_mutex_unlock(&log_mutex);
+    }
+    double deferred = spent / turns;
+    unsigned dropped = log_dropped;
+
+    printf("LOG_LEVEL=%d turns=%d\n", LOG_LEVEL, turns);
+    printf("  legacy   %8.1f ns/turn\n", legacy);
+    long records = (long)turns * ((LOG_LEVEL <= LOG_LEVEL_DEBUG ? 2 : 0) + (LOG_LEVEL <= LOG_LEVEL_INFO ? 1 : 0));
+    printf("  deferred %8.1f ns/turn, %u of %ld records dropped (%.2f%%)\n",
+           deferred, dropped, records, records ? 100.0 * dropped / records : 0.0);
+    return 0;
+}
+
+// Arm n timers spread over 10 minutes of ticks, cancel half of them and
+// run the wheel until the rest have fired.
+static int benchTimers(int n) {
+    const uint64_t span = 600000 / SCHED_TICK_MS;
+
+    TimerWheel* w = new TimerWheel;
+    wheelInit(w);
+    TimerNode* nodes = new TimerNode[n];
+
+    // Each expiry also checks it ran on exactly the tick it was armed for
+    struct Counter {
+        TimerWheel* w; TimerNode* nodes; long fired; long late;
+        static void fire(void* arg, int i) {
+            Counter* c = (Counter*)arg;
+            c->fired++;
+            if (c->nodes[i].expires != c->w->next - 1) c->late++;
+        }
+    };
+    Counter c = {w, nodes, 0, 0};
+    srand(12345);
+
+    double t0 = nowNs();
+    for (int i = 0; i < n; i++) {
+        timerInit(&nodes[i], Counter::fire, &c, i);
+        timerArm(w, &nodes[i], 1 + (uint64_t)rand() % span);
+    }
+    double arm = (nowNs() - t0) / n;
+
+    size_t peak = w->armed;
+    t0 = nowNs();
+    for (int i = 0; i < n; i += 2) timerCancel(w, &nodes[i]);
+    double cancel = (nowNs() - t0) / ((n + 1) / 2);
+
+    long expected = (long)w->armed;
+    t0 = nowNs();
+    for (uint64_t t = 0; t < span; t++) wheelAdvance(w, 1);
+    double run = nowNs() - t0;
+
+    printf("timers=%d armed=%zu span=%llu ticks\n", n, peak, (unsigned long long)span);
+    printf("  arm     %8.1f ns/timer\n", arm);
+    printf("  cancel  %8.1f ns/timer\n", cancel);
+    printf("  advance %8.1f ns/tick, %.1f ns/expiry (fired %ld of %ld, %ld off-tick)\n",
+           run / span, c.fired ? run / c.fired : 0.0, c.fired, expected, c.late);
+
+    delete[] nodes;
+    delete w;
+    return (c.fired == expected && c.late == 0) ? 0 : 1;
+}
+
+// Guesses/sec of the sharded runtime with 1..max_shards shards. All bot
+// rooms start on shard 0, so every other shard gets its rooms by stealing.
+static int benchShards(int max_shards, int nrooms, int seconds) {
+    printf("rooms=%d seconds=%d cpus=%ld\n", nrooms, seconds, sysconf(_SC_NPROCESSORS_ONLN));
+    double base = 0;
+
+    for (int s = 1; s <= max_shards; s++) {
+        ShardRuntime rt;
+        runtimeInit(&rt, s, 10000, 60000);
+        for (int i = 0; i < nrooms; i++) {
+            // Every 8th room is hot
+            runtimeAddRoom(&rt, roomCreate(i, (i % 8 == 0) ? 32 : 4), 0);
+        }
+        runtimeStart(&rt);
+
+        usleep(500 * 1000);                 // let stealing settle
+        long g0 = runtimeGuesses(&rt);
+        double t0 = nowNs();
+        sleep(seconds);
+        double rate = (runtimeGuesses(&rt) - g0) / ((nowNs() - t0) / 1e9);
+        if (s == 1) base = rate;
+
+        printf("  shards=%2d %12.0f guesses/s  x%.2f  rooms(load)/shard:", s, rate, rate / base);
+        long steals = 0;
+        for (int i = 0; i < s; i++) {
+            printf(" %d(%.0f)", rt.shards[i].nrooms.load(), (double)rt.shards[i].load.load() / LOAD_SCALE);
+            steals += rt.shards[i].steals.load();
+        }
+        printf("  steals=%ld\n", steals);
+        runtimeStop(&rt);
+    }
+    return 0;
+}
+
+// Journal `games` finished games among `players` players, then query the
+// last 50 games of random players, before and after reopening.
+static int benchHistory(int games, int players) {
+    const char* dir = "/tmp/guess_game_history_bench";
+    if (DIR* d = opendir(dir)) {
+        while (dirent* e = readdir(d)) {
+            if (e->d_name[0] != '.') unlink((string(dir) + "/" + e->d_name).c_str());
+        }
+        closedir(d);
+    }
+
+    GameHistory h;
+    if (!historyOpen(&h, dir)) return 1;
+
+    srand(4242);
+    vector<GameRecord> sample(1024);
+    for (size_t i = 0; i < sample.size(); i++) {
+        GameRecord& g = sample[i];
+        g.start_ms = wallMs();
+        g.duration_ms = 1000 + rand() % 60000;
+        g.room = rand() % 64;
+        for (int s = 0; s < MAX_PLAYERS; s++) g.players[s] = HIST_NO_PLAYER;
+        int seats = 2 + rand() % (MAX_PLAYERS - 1);
+        for (int s = 0; s < seats; s++) g.players[s] = rand() % players;
+        int nmoves = 4 + rand() % 5;
+        for (int m = 0; m < nmoves; m++) {
+            GameMove mv = {(uint8_t)(m % seats), (uint8_t)(1 + rand() % 100), 0, (uint32_t)(m * 1500)};
+            g.moves.push_back(mv);
+        }
+        g.winner = g.moves.back().seat;
+    }
+
+    double t0 = nowNs();
+    for (int i = 0; i < games; i++) {
+        GameRecord& g = sample[i % sample.size()];
+        for (int s = 0; s < MAX_PLAYERS && g.players[s] != HIST_NO_PLAYER; s++) g.players[s] = rand() % players;
+        historyAppend(&h, g);
+    }
+    double enqueue = (nowNs() - t0) / games;
+    historyFlush(&h);
+    double total = (nowNs() - t0) / 1e9;
+
+    size_t disk = 0;
+    struct stat sb;
+    for (size_t i = 0; i < h.segments.size(); i++) {
+        if (stat(histPath(&h, h.segments[i].id, "log").c_str(), &sb) == 0) disk += sb.st_size;
+        if (stat(histPath(&h, h.segments[i].id, "idx").c_str(), &sb) == 0) disk += sb.st_size;
+    }
+    size_t nsegs = h.segments.size();
+    long compactions = h.compactions;
+
+    const int QUERIES = 2000;
+    vector<GameRecord> out;
+    size_t returned = 0;
+    t0 = nowNs();
+    for (int q = 0; q < QUERIES; q++) returned += historyLastGames(&h, rand() % players, 50, out);
+    double query = (nowNs() - t0) / QUERIES / 1000;
+
+    uint32_t probe = sample[0].players[0];
+    size_t before = historyLastGames(&h, probe, 50, out);
+    uint64_t newest = before ? out[0].game_id : 0;
+    historyClose(&h);
+
+    GameHistory h2;
+    t0 = nowNs();
+    historyOpen(&h2, dir);
+    double reopen = (nowNs() - t0) / 1e6;
+    size_t after = historyLastGames(&h2, probe, 50, out);
+    bool same = after == before && (!after || out[0].game_id == newest);
+    historyClose(&h2);
+
+    printf("games=%d players=%d\n", games, players);
+    printf("  append   %8.1f ns/game on the game path, %.0f games/s written\n", enqueue, games / total);
+    printf("  disk     %8.1f MB in %zu segments after %ld compactions\n", disk / 1e6, nsegs, compactions);
+    printf("  query    %8.1f us per last-50 (avg %.1f games returned)\n", query, (double)returned / QUERIES);
+    printf("  reopen   %8.1f ms, player %u: %zu games before, %zu after%s\n",
+           reopen, probe, before, after, same ? "" : " MISMATCH");
+    return same ? 0 : 1;
+}
+
+// The three handler spans of one guess, with tracing off and on. The
+// enabled spans are flushed to a scratch file every 1/8 ring, as the
+// handler's idle flush would; that cost is reported on its own since it
+// is paid off the game path.
+static int benchTrace(int guesses) {
+    bool was = trace_enabled;
+    double per[2];
+    double flush = 0;
+
+    for (int on = 0; on < 2; on++) {
+        trace_enabled = on;
+        double spent = 0;
+        double t0 = nowNs();
+        for (int i = 0; i < guesses; i++) {
+            uint64_t id = (uint64_t)i + 1;
+            int64_t t = traceBegin();
+            traceEnd("fifo_read", id, t, 't');
+            t = traceBegin();
+            traceEnd("processGuess", id, t, 't');
+            t = traceBegin();
+            traceEnd("response_write", id, t, 't');
+            if (on && (i & (TRACE_RING / 8 - 1)) == 0) {
+                double f0 = nowNs();
+                traceFlush();
+                spent += nowNs() - f0;
+            }
+        }
+        double f0 = nowNs();
+        traceFlush();
+        spent += nowNs() - f0;
+        per[on] = (nowNs() - t0 - spent) / guesses;
+        if (on) flush = spent / guesses;
+    }
+    trace_enabled = was;
+
+    char path[64];
+    snprintf(path, sizeof(path), "%s%d.jsonl", TRACE_PREFIX, getpid());
+    unlink(path);
+
+    printf("guesses=%d (3 spans each)\n", guesses);
+    printf("  disabled %8.1f ns/guess\n", per[0]);
+    printf("  enabled  %8.1f ns/guess recorded, +%.1f ns/guess to flush (lost %llu)\n",
+           per[1], flush, (unsigned long long)trace_lost);
+    return 0;
+}
+
+// Join every process's /tmp/guess_game_trace.<pid>.jsonl into one file
+// that chrome://tracing and ui.perfetto.dev open directly. Files of
+// processes still running stay; the rest are consumed by the merge.
+static int traceMerge(const char* out_path) {
+    FILE* out = fopen(out_path, "w");
+    if (!out) {
+        perror(out_path);
+        return 1;
+    }
+    DIR* dir = opendir("/tmp");
+    if (!dir) {
+        perror("/tmp");
+        fclose(out);
+        return 1;
+    }
+
+    const char* base = TRACE_PREFIX + strlen("/tmp/");
+    size_t base_len = strlen(base);
+    long events = 0;
+    int files = 0;
+    vector<string> done;
+    fputs("{\"traceEvents\":[\n", out);
+
+    while (dirent* d = readdir(dir)) {
+        size_t len = strlen(d->d_name);
+        if (len <= base_len + 6 || strncmp(d->d_name, base, base_len) != 0 ||
+            strcmp(d->d_name + len - 6, ".jsonl") != 0) continue;
+
+        string path = string("/tmp/") + d->d_name;
+        ifstream in(path.c_str());
+        string line;
+        while (getline(in, line)) {
+            if (line.empty()) continue;
+            fputs(events++ ? ",\n" : "", out);
+            fputs(line.c_str(), out);
+        }
+        files++;
+        if (!pidAlive(atoi(d->d_name + base_len))) done.push_back(path);
+    }
+    closedir(dir);
+
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", out);
+    if (fclose(out) != 0) {
+        perror(out_path);
+        return 1;           // keep the inputs for another try
+    }
+    for (size_t i = 0; i < done.size(); i++) unlink(done[i].c_str());
+    printf("%ld events from %d processes -> %s\n", events, files, out_path);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    logInitFork();
+    traceInit("server");
+
+    if (argc >= 2 && strcmp(argv[1], "history") == 0) {
+        if (argc < 3) {
+            printf("Usage: ./server history <player> [n] [dir]\n"
+                   "  player: 0-3 (single room) or 1000 + room * 4 + seat (multi)\n");
+            return 1;
+        }
+        return historyQuery((uint32_t)atoi(argv[2]), argc >= 4 ? atoi(argv[3]) : 10,
+                            argc >= 5 ? argv[4] : HISTORY_DIR);
+    }
+    if (argc >= 2 && strcmp(argv[1], "trace-merge") == 0) {
+        return traceMerge(argc >= 3 ? argv[2] : "trace.json");
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench-trace") == 0) {
+        return benchTrace(argc >= 3 ? atoi(argv[2]) : 200000);
+    }
+    if (argc >= 2 && strcmp(argv[1], "multi") == 0) {
+        signal(SIGINT, sigintHandler);
+        return runMulti(argc >= 3 ? atoi(argv[2]) : 4, argc >= 4 ? atoi(argv[3]) : 0);
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench-log") == 0) {
+        return benchLog(argc >= 3 ? atoi(argv[2]) : 1000000);
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench-timers") == 0) {
+        return benchTimers(argc >= 3 ? atoi(argv[2]) : 1000000);
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench-history") == 0) {
+        return benchHistory(argc >= 3 ? atoi(argv[2]) : 1000000,
+                            argc >= 4 ? atoi(argv[3]) : 5000);
+    }
+    if (argc >= 2 && strcmp(argv[1], "bench-shards") == 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        return benchShards(argc >= 3 ? atoi(argv[2]) : (int)ncpu,
+                           argc >= 4 ? atoi(argv[3]) : 256,
+                           argc >= 5 ? atoi(argv[4]) : 2);
+    }
+
+    signal(SIGINT, sigintHandler);
+
+    SharedState* st = createOrOpenSharedMemory(true);
+    if (!st) return 1;
+
+    memset(st, 0, sizeof(SharedState));
+    initProcessSharedMutex(&st->shared_mutex);
+
+    stateLock(st);
+    st->shared_int[0] = 0;   // current player
+    st->shared_int[1] = 0;   // connected_mask (start empty)
+    st->shared_int[2] = 0;   // turn_done 
+    st->shared_int[3] = 0;   // game running
+    st->winner = -1;
+    st->moves.start_ms = wallMs();
+    pthread_mutex_unlock(&st->shared_mutex);
+
+    // Create server FIFO
+    int fifo_result = mkfifo("/tmp/guess_game_server", 0666);
+    if (fifo_result == -1) {
+        perror("mkfifo failed");
+    } else {
+        cout << "Server FIFO CREATED SUCCESSFULLY" << endl;
+    }
+
+    loadScores();
+
+    // ============ ADD THIS LINE ============
+    startNewGame();  // Start the guessing game!
+    // ============ END ADDED CODE ============
+
+    printf("Server listening on port 8080...\n");
+    printf("Waiting for players to connect...\n");
+
+    printf("Game started!\n");
+
+    LOG_INFO("[MAIN] Forking client processes...");
+    
+    // Fork child processes for 4 players
+    for (int i = 0; i < 4; i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            // Child process: handle one client (with its own logger thread)
+            trace_process = "handler";
+            startLogger();
+            handleClient(st, -1, i);
+            stopLogger();
+            exit(0);  // IMPORTANT: Exit after handling
+        }
+        else if (pid > 0) {
+            printf("Forked player %d (PID: %d)\n", i, pid);
+            LOG_INFO("[MAIN] Forked player {} (PID: {})", i, pid);
+        }
+    }
+        // ---- Scheduler thread ----
+    GameHistory history;
+    bool have_history = historyOpen(&history, HISTORY_DIR);
+    if (!have_history) LOG_WARN("[HISTORY] Cannot open {}, games will not be journaled", HISTORY_DIR);
+
+    SchedulerArgs schedArgs{st, 10000, 60000, have_history ? &history : nullptr};
+    pthread_t sched_tid;
+    pthread_create(&sched_tid, nullptr, roundRobinThread, &schedArgs);
+
+    // ---- Logger thread ----
+    startLogger();
+    
+    LOG_INFO("[MAIN] Server running.");
+
+    // ---- Main loop ----
+    while (!g_stop) {
+        usleep(100 * 1000);
+    }
+
+    printf("Server shutting down...\n");
+    LOG_INFO("[SIGNAL] SIGINT received. Saving scores...");
+
+    saveScores();
+
+    stateLock(st);
+    st->shared_int[3] = 1; // stop scheduler
+    pthread_mutex_unlock(&st->shared_mutex);
+
+    pthread_join(sched_tid, nullptr);
+    if (have_history) historyClose(&history);
+
+    traceFlush();
+    stopLogger();
+
+    munmap(st, sizeof(SharedState));
+    shm_unlink(SHM_NAME);
+
+    return 0;
 }
\ No newline at end of file